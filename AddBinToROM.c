@@ -25,11 +25,16 @@
 /* the utility BinToMotorola to convert the binary ROM file into a Motorola */
 /* S record text file which can be sent to the EPP-2 Programmer using the   */
 /* EPP-2_PROG command line application.                                     */
+/*                                                                          */
+/* Alternatively a manifest file lists every asset of the ROM, the whole    */
+/* ROM file is then built in memory and written once, optionally with a     */
+/* Motorola S record file. Assets with overlapping ranges are reported.     */
 /****************************************************************************/
 
 
 #include <stdio.h>
 #include <string.h>
+#include "Image.h"
 
 
 #define ARG_COUNT             5
@@ -38,12 +43,56 @@
 #define ARG_START_ADR         2
 #define ARG_END_ADR           3
 #define ARG_BIN_FILE          4
+#define ARG_MANIFEST          2
+#define ARG_FORMAT            3
 
 #define BUFF_SIZE             255
 #define ROM_SIZE              0x10000
 
 
 
+/*******************************************************************/
+/* Build the ROM file from all of the assets listed in a manifest. */
+/*******************************************************************/
+void AddManifest(char* ROMFile, char* ManifestFile, short Record)
+{
+   FILE* File;
+   unsigned long Size;
+   ImageType Image;
+   ManifestType Manifest;
+   char Buffer[BUFF_SIZE + 1];
+
+   if (!ImageReadManifest(&Manifest, ManifestFile))
+      return;
+   if (!ImageCreate(&Image))
+      printf("Failed to allocate memory for the image\r\n");
+   else
+   {
+      if (ImageLoadManifest(&Image, &Manifest))
+      {
+         printf("ADDED %d FILES, %lu BYTES: %6.6lX - %6.6lX\r\n", Manifest.Count, Image.ByteCount, Image.Start, Image.End);
+  /*****************************************************************/
+ /* Write the ROM file in one go, at least the classic 64K size.  */
+/*****************************************************************/
+         Size = (Image.ByteCount && Image.End >= ROM_SIZE) ? Image.End + 1 : ROM_SIZE;
+         if (!(File = fopen(ROMFile, "wb")))
+            printf("Failed to write ROM file: %s\r\n", ROMFile);
+         else
+         {
+            fwrite(Image.Data, Size, 1, File);
+            fclose(File);
+         }
+         snprintf(Buffer, BUFF_SIZE, "%s.HEX", ROMFile);
+         if (Record && !ImageWriteMotorola(&Image, Buffer, IMAGE_RECORD_SIZE))
+            printf("Failed to write Motorola S-Record file: %s\r\n", Buffer);
+      }
+      ImageFree(&Image);
+   }
+   ImageFreeManifest(&Manifest);
+}
+
+
+
 int main(int argc, char* argv[])
 {
    FILE* File;
@@ -58,14 +107,20 @@ int main(int argc, char* argv[])
    char BinFile[ROM_SIZE];
    char Buffer[BUFF_SIZE + 1];
    
-   if (argc < ARG_COUNT)
+   if (argc == ARG_MANIFEST + 1 || (argc == ARG_FORMAT + 1 && !strcmp(argv[ARG_FORMAT], "S")))
+      AddManifest(argv[ARG_ROM_FILE], argv[ARG_MANIFEST], argc > ARG_FORMAT);
+   else if (argc < ARG_COUNT)
    {
       printf("\n%s [ROM_FILE] [START_ADR] [END_ADR] [BIN_FILE]\n", argv[ARG_EXE]);
+      printf("%s [ROM_FILE] [MANIFEST] <S>\n", argv[ARG_EXE]);
       printf("WHERE:\n");
       printf("[ROM_FILE]  - ROM File to add binary data to or new ROM file.\n");
       printf("[START_ADR] - Start address to add data.\n");
       printf("[END_ADR]   - End address to add data & pad with 0xFF.\n");
       printf("[BIN_FILE]  - Binary file to add to ROM file.\n");
+      printf("[MANIFEST]  - File listing [START_ADR] [END_ADR] [BIN_FILE] <FILL> of each\n");
+      printf("              binary file, to build a new ROM file from in one go.\n");
+      printf("<S>         - Also write a Motorola S record file, [ROM_FILE].HEX\n");
       printf("\n");
    }
    else
@@ -0,0 +1,516 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* Archive - Deduplicating store of device images read back from EPROMs.    */
+/* ------------------------------------------------------------------------ */
+/* Each image is cut into chunks of 256 bytes to 4 KB where a rolling hash  */
+/* of the data ends a chunk, so the chunks of two revisions of a firmware   */
+/* line up again after an inserted or removed byte. A chunk is only stored  */
+/* once, later images refer to the stored chunk. The offset of each chunk   */
+/* in an image is held, so any address range is read without reading the    */
+/* rest of the image.                                                       */
+/*                                                                          */
+/* The archive file starts with EPP2ARC1, followed by records which are     */
+/* only ever appended, numbers are little endian:                           */
+/* C [LENGTH 4] [HASH 8] [DATA]                                             */
+/* I [NAME_LENGTH 2] [NAME] [START 4] [SIZE 4] [COUNT 4] [CHUNK 4] ...      */
+/* Chunks are numbered in the order of the file.                            */
+/****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "Archive.h"
+#include "Log.h"
+
+
+static unsigned long long ArchiveGear[256];
+static short ArchiveGearReady = FALSE;
+
+
+
+/****************************************************************/
+/* Random value of each byte for the rolling hash, from a fixed */
+/* seed, so every archive cuts the same data at the same place. */
+/****************************************************************/
+static void ArchiveGearInit(void)
+{
+   short Count;
+   unsigned long long State = ARCHIVE_GEAR_SEED;
+   unsigned long long Value;
+
+   for (Count = 0; Count < 256; ++Count)
+   {
+      // SplitMix64.
+      Value = (State += 0x9E3779B97F4A7C15ULL);
+      Value = (Value ^ (Value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      Value = (Value ^ (Value >> 27)) * 0x94D049BB133111EBULL;
+      ArchiveGear[Count] = Value ^ (Value >> 31);
+   }
+   ArchiveGearReady = TRUE;
+}
+
+
+
+/************************************************/
+/* Write a little endian number of Bytes bytes. */
+/************************************************/
+static void ArchivePut(FILE* File, unsigned long long Value, short Bytes)
+{
+   while (Bytes--)
+   {
+      fputc(Value & 0xFF, File);
+      Value >>= 8;
+   };
+}
+
+
+
+/***********************************************/
+/* Read a little endian number of Bytes bytes. */
+/* Returns FALSE at the end of the file.       */
+/***********************************************/
+static short ArchiveGet(FILE* File, unsigned long long* Value, short Bytes)
+{
+   int Byte;
+   short Count;
+
+   *Value = 0;
+   for (Count = 0; Count < Bytes; ++Count)
+   {
+      if ((Byte = fgetc(File)) == EOF)
+         return FALSE;
+      *Value |= (unsigned long long)Byte << (8 * Count);
+   }
+
+   return TRUE;
+}
+
+
+
+/*********************************************************************/
+/* Add a chunk to the hash table, doubling the table when half full. */
+/* Returns FALSE if memory could not be allocated.                   */
+/*********************************************************************/
+static short ArchiveInsert(ArchiveType* Archive, unsigned long Chunk)
+{
+   unsigned long Slot;
+   unsigned long Count;
+   unsigned long* Slots;
+
+   if (2 * (Chunk + 1) > Archive->SlotCount)
+   {
+      if (!(Slots = calloc(Archive->SlotCount ? 2 * Archive->SlotCount : 1024, sizeof(unsigned long))))
+         return FALSE;
+      free(Archive->Slots);
+      Archive->Slots = Slots;
+      Archive->SlotCount = Archive->SlotCount ? 2 * Archive->SlotCount : 1024;
+      for (Count = 0; Count < Chunk; ++Count)
+         ArchiveInsert(Archive, Count);
+   }
+   for (Slot = Archive->Chunks[Chunk].Hash & (Archive->SlotCount - 1); Archive->Slots[Slot]; Slot = (Slot + 1) & (Archive->SlotCount - 1));
+   Archive->Slots[Slot] = Chunk + 1;
+
+   return TRUE;
+}
+
+
+
+/*****************************************************************/
+/* Add a chunk stored at Position of the file to the chunk list. */
+/* Returns FALSE if memory could not be allocated.               */
+/*****************************************************************/
+static short ArchiveNewChunk(ArchiveType* Archive, IndexHashType Hash, long Position, unsigned long Length)
+{
+   ArchiveChunkType* Chunks;
+
+   if (Archive->ChunkCount == Archive->ChunkSpace)
+   {
+      if (!(Chunks = realloc(Archive->Chunks, (Archive->ChunkSpace ? 2 * Archive->ChunkSpace : 1024) * sizeof(ArchiveChunkType))))
+         return FALSE;
+      Archive->Chunks = Chunks;
+      Archive->ChunkSpace = Archive->ChunkSpace ? 2 * Archive->ChunkSpace : 1024;
+   }
+   Archive->Chunks[Archive->ChunkCount].Hash = Hash;
+   Archive->Chunks[Archive->ChunkCount].Position = Position;
+   Archive->Chunks[Archive->ChunkCount].Length = Length;
+   Archive->Stored += Length;
+
+   return ArchiveInsert(Archive, Archive->ChunkCount++);
+}
+
+
+
+/*******************************************************************/
+/* Add an image to the image list, taking the Chunks array. The    */
+/* offset of each chunk in the image is worked out from the chunk  */
+/* lengths. Returns FALSE if the chunks do not make up Size bytes. */
+/*******************************************************************/
+static short ArchiveNewImage(ArchiveType* Archive, char* Name, unsigned long Start, unsigned long Size, unsigned long ChunkCount, unsigned long* Chunks)
+{
+   unsigned long Count;
+   unsigned long Offset = 0;
+   ArchiveImageType* Images;
+   ArchiveImageType* Image;
+
+   if (!(Images = realloc(Archive->Images, (Archive->ImageCount + 1) * sizeof(ArchiveImageType))))
+      return FALSE;
+   Archive->Images = Images;
+   Image = &(Archive->Images[Archive->ImageCount]);
+   memset(Image, 0, sizeof(ArchiveImageType));
+   strncpy(Image->Name, Name, ARCHIVE_NAME_SIZE);
+   Image->Start = Start;
+   Image->Size = Size;
+   Image->ChunkCount = ChunkCount;
+   Image->Chunks = Chunks;
+   if (!(Image->Offsets = malloc((ChunkCount + 1) * sizeof(unsigned long))))
+      return FALSE;
+   for (Count = 0; Count < ChunkCount; ++Count)
+   {
+      if (Chunks[Count] >= Archive->ChunkCount)
+         break;
+      Image->Offsets[Count] = Offset;
+      Offset += Archive->Chunks[Chunks[Count]].Length;
+   }
+   if (Count < ChunkCount || Offset != Size)
+   {
+      free(Image->Offsets);
+      return FALSE;
+   }
+   ++Archive->ImageCount;
+
+   return TRUE;
+}
+
+
+
+/*************************************************************************/
+/* Read the records of an archive file into the chunk and image lists.   */
+/* A record cut short, by a write which was broken off, ends the archive */
+/* and is removed. Returns FALSE if the file is not a valid archive.     */
+/*************************************************************************/
+static short ArchiveScan(ArchiveType* Archive, char* FileName)
+{
+   short Result = TRUE;
+   int Type;
+   long End;
+   long FileSize;
+   unsigned long Count;
+   unsigned long long Length;
+   unsigned long long Hash;
+   unsigned long long Start;
+   unsigned long long Size;
+   unsigned long long ChunkCount;
+   unsigned long long Chunk;
+   unsigned long* Chunks;
+   char Magic[ARCHIVE_MAGIC_SIZE];
+   char Name[ARCHIVE_NAME_SIZE + 1];
+
+   if (fread(Magic, 1, ARCHIVE_MAGIC_SIZE, Archive->File) != ARCHIVE_MAGIC_SIZE || memcmp(Magic, ARCHIVE_MAGIC, ARCHIVE_MAGIC_SIZE))
+   {
+      LogPrint(LOG_ERROR, "NOT AN ARCHIVE FILE: %s\r\n", FileName);
+      return FALSE;
+   }
+
+   fseek(Archive->File, 0, SEEK_END);
+   FileSize = ftell(Archive->File);
+   fseek(Archive->File, ARCHIVE_MAGIC_SIZE, SEEK_SET);
+   End = ARCHIVE_MAGIC_SIZE;
+   while ((Type = fgetc(Archive->File)) != EOF)
+   {
+      if (Type == ARCHIVE_CHUNK)
+      {
+         if (!ArchiveGet(Archive->File, &Length, 4) || !ArchiveGet(Archive->File, &Hash, 8) || End + 13 + (long)Length > FileSize)
+            break;
+         if (!Length || Length > ARCHIVE_MAX_CHUNK || !ArchiveNewChunk(Archive, Hash, End + 13, Length))
+            Result = FALSE;
+         fseek(Archive->File, End + 13 + Length, SEEK_SET);
+      }
+      else if (Type == ARCHIVE_IMAGE)
+      {
+         if (!ArchiveGet(Archive->File, &Length, 2) || Length > ARCHIVE_NAME_SIZE
+            || fread(Name, 1, Length, Archive->File) != Length || !ArchiveGet(Archive->File, &Start, 4)
+            || !ArchiveGet(Archive->File, &Size, 4) || !ArchiveGet(Archive->File, &ChunkCount, 4)
+            || ftell(Archive->File) + 4 * (long)ChunkCount > FileSize)
+            break;
+         Name[Length] = '\0';
+         if (!(Chunks = malloc((ChunkCount + 1) * sizeof(unsigned long))))
+            Result = FALSE;
+         for (Count = 0; Result && Count < ChunkCount && ArchiveGet(Archive->File, &Chunk, 4); ++Count)
+            Chunks[Count] = Chunk;
+         if (Result && !ArchiveNewImage(Archive, Name, Start, Size, ChunkCount, Chunks))
+         {
+            free(Chunks);
+            Result = FALSE;
+         }
+      }
+      else
+         Result = FALSE;
+      if (!Result)
+      {
+         LogPrint(LOG_ERROR, "INVALID ARCHIVE FILE: %s\r\n", FileName);
+         return FALSE;
+      }
+      End = ftell(Archive->File);
+   };
+
+  /**********************************************************/
+ /* Anything after the last whole record is cut away.      */
+/**********************************************************/
+   fseek(Archive->File, 0, SEEK_END);
+   if (ftell(Archive->File) > End)
+   {
+      LogPrint(LOG_ERROR, "ARCHIVE CUT SHORT, %ld BYTES REMOVED: %s\r\n", ftell(Archive->File) - End, FileName);
+      fflush(Archive->File);
+      if (ftruncate(fileno(Archive->File), End))
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+
+/*******************************************************************/
+/* Open an archive file, creating it if it does not exist. Returns */
+/* FALSE if the file could not be opened or is not an archive.     */
+/*******************************************************************/
+short ArchiveOpen(ArchiveType* Archive, char* FileName)
+{
+   memset(Archive, 0, sizeof(ArchiveType));
+   if (!ArchiveGearReady)
+      ArchiveGearInit();
+   if ((Archive->File = fopen(FileName, "r+b")))
+   {
+      if (ArchiveScan(Archive, FileName))
+         return TRUE;
+      ArchiveClose(Archive);
+      return FALSE;
+   }
+   if (!(Archive->File = fopen(FileName, "w+b")))
+   {
+      LogPrint(LOG_ERROR, "Failed to open archive file: %s\r\n", FileName);
+      return FALSE;
+   }
+   fwrite(ARCHIVE_MAGIC, 1, ARCHIVE_MAGIC_SIZE, Archive->File);
+
+   return TRUE;
+}
+
+
+
+void ArchiveClose(ArchiveType* Archive)
+{
+   unsigned long Count;
+
+   if (Archive->File)
+      fclose(Archive->File);
+   for (Count = 0; Count < Archive->ImageCount; ++Count)
+   {
+      free(Archive->Images[Count].Chunks);
+      free(Archive->Images[Count].Offsets);
+   }
+   free(Archive->Images);
+   free(Archive->Chunks);
+   free(Archive->Slots);
+   memset(Archive, 0, sizeof(ArchiveType));
+}
+
+
+
+/**********************************************************************/
+/* Length of the next chunk of Length bytes of data, ending where the */
+/* top bits of the rolling hash of the last 64 bytes are all 0.       */
+/**********************************************************************/
+unsigned long ArchiveCut(unsigned char* Data, unsigned long Length)
+{
+   unsigned long Count;
+   unsigned long long Hash = 0;
+
+   if (!ArchiveGearReady)
+      ArchiveGearInit();
+   if (Length > ARCHIVE_MAX_CHUNK)
+      Length = ARCHIVE_MAX_CHUNK;
+   for (Count = 0; Count < Length; ++Count)
+   {
+      Hash = (Hash << 1) + ArchiveGear[Data[Count]];
+      if (Count >= ARCHIVE_MIN_CHUNK && !(Hash & ARCHIVE_CHUNK_MASK))
+         return Count + 1;
+   }
+
+   return Length;
+}
+
+
+
+/*********************************************************************/
+/* Find a stored chunk with the same data. Returns the chunk number, */
+/* or -1 if the data is not stored.                                  */
+/*********************************************************************/
+static long ArchiveMatch(ArchiveType* Archive, IndexHashType Hash, unsigned char* Data, unsigned long Length)
+{
+   unsigned long Slot;
+   ArchiveChunkType* Chunk;
+   unsigned char Buffer[ARCHIVE_MAX_CHUNK];
+
+   if (!Archive->SlotCount)
+      return -1;
+   for (Slot = Hash & (Archive->SlotCount - 1); Archive->Slots[Slot]; Slot = (Slot + 1) & (Archive->SlotCount - 1))
+   {
+      Chunk = &(Archive->Chunks[Archive->Slots[Slot] - 1]);
+      // The data is compared too, a hash is not proof of the same data.
+      if (Chunk->Hash == Hash && Chunk->Length == Length && !fseek(Archive->File, Chunk->Position, SEEK_SET)
+         && fread(Buffer, 1, Length, Archive->File) == Length && !memcmp(Buffer, Data, Length))
+         return Archive->Slots[Slot] - 1;
+   }
+
+   return -1;
+}
+
+
+
+/***********************************************************************/
+/* Add Size bytes of an image at device address Start to the archive,  */
+/* storing only the chunks not already in the archive. NewBytes is set */
+/* to the bytes of chunk data added to the file. Returns FALSE if the  */
+/* file could not be written.                                          */
+/***********************************************************************/
+short ArchiveAdd(ArchiveType* Archive, char* Name, unsigned char* Data, unsigned long Start, unsigned long Size, unsigned long* NewBytes)
+{
+   long Found;
+   unsigned long Offset;
+   unsigned long Length;
+   unsigned long ChunkCount = 0;
+   unsigned long Count;
+   unsigned long* Chunks;
+   IndexHashType Hash;
+
+   *NewBytes = 0;
+   if (!Size || !(Chunks = malloc((Size / ARCHIVE_MIN_CHUNK + 1) * sizeof(unsigned long))))
+      return FALSE;
+
+  /*****************************************************************/
+ /* Store each chunk not found, at the end of the file.           */
+/*****************************************************************/
+   for (Offset = 0; Offset < Size; Offset += Length)
+   {
+      Length = ArchiveCut(&(Data[Offset]), Size - Offset);
+      Hash = IndexHash(&(Data[Offset]), Length);
+      if ((Found = ArchiveMatch(Archive, Hash, &(Data[Offset]), Length)) < 0)
+      {
+         fseek(Archive->File, 0, SEEK_END);
+         fputc(ARCHIVE_CHUNK, Archive->File);
+         ArchivePut(Archive->File, Length, 4);
+         ArchivePut(Archive->File, Hash, 8);
+         if (fwrite(&(Data[Offset]), 1, Length, Archive->File) != Length
+            || !ArchiveNewChunk(Archive, Hash, ftell(Archive->File) - Length, Length))
+         {
+            free(Chunks);
+            return FALSE;
+         }
+         Found = Archive->ChunkCount - 1;
+         *NewBytes += Length;
+      }
+      Chunks[ChunkCount++] = Found;
+   }
+
+  /******************************************************************/
+ /* Then the image, so an image is only found with all its chunks. */
+/******************************************************************/
+   fseek(Archive->File, 0, SEEK_END);
+   fputc(ARCHIVE_IMAGE, Archive->File);
+   ArchivePut(Archive->File, strlen(Name) > ARCHIVE_NAME_SIZE ? ARCHIVE_NAME_SIZE : strlen(Name), 2);
+   fwrite(Name, 1, strlen(Name) > ARCHIVE_NAME_SIZE ? ARCHIVE_NAME_SIZE : strlen(Name), Archive->File);
+   ArchivePut(Archive->File, Start, 4);
+   ArchivePut(Archive->File, Size, 4);
+   ArchivePut(Archive->File, ChunkCount, 4);
+   for (Count = 0; Count < ChunkCount; ++Count)
+      ArchivePut(Archive->File, Chunks[Count], 4);
+   if (fflush(Archive->File) || fsync(fileno(Archive->File)) || !ArchiveNewImage(Archive, Name, Start, Size, ChunkCount, Chunks))
+   {
+      free(Chunks);
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+
+/*****************************************************************/
+/* The last image added with the Name, or NULL if there is none. */
+/*****************************************************************/
+ArchiveImageType* ArchiveFind(ArchiveType* Archive, char* Name)
+{
+   unsigned long Count;
+
+   for (Count = Archive->ImageCount; Count; --Count)
+      if (!strcmp(Archive->Images[Count - 1].Name, Name))
+         return &(Archive->Images[Count - 1]);
+
+   return NULL;
+}
+
+
+
+/********************************************************************/
+/* Read the device addresses Start to End of an image into Data,    */
+/* reading only the chunks of the range. Returns FALSE if the range */
+/* is outside the image or the file could not be read.              */
+/********************************************************************/
+short ArchiveRead(ArchiveType* Archive, ArchiveImageType* Image, unsigned long Start, unsigned long End, unsigned char* Data)
+{
+   unsigned long Low = 0;
+   unsigned long High;
+   unsigned long Middle;
+   unsigned long Skip;
+   unsigned long Length;
+   ArchiveChunkType* Chunk;
+
+   if (Start < Image->Start || End < Start || End - Image->Start >= Image->Size)
+      return FALSE;
+   Start -= Image->Start;
+   End -= Image->Start;
+
+  /**************************************************/
+ /* Find the chunk holding Start by its offset.    */
+/**************************************************/
+   High = Image->ChunkCount - 1;
+   while (Low < High)
+   {
+      Middle = (Low + High + 1) / 2;
+      if (Image->Offsets[Middle] <= Start)
+         Low = Middle;
+      else
+         High = Middle - 1;
+   };
+
+   for (; Start <= End; ++Low)
+   {
+      Chunk = &(Archive->Chunks[Image->Chunks[Low]]);
+      Skip = Start - Image->Offsets[Low];
+      Length = (Chunk->Length - Skip > End - Start + 1) ? End - Start + 1 : Chunk->Length - Skip;
+      if (fseek(Archive->File, Chunk->Position + Skip, SEEK_SET) || fread(Data, 1, Length, Archive->File) != Length)
+         return FALSE;
+      Data += Length;
+      Start += Length;
+   }
+
+   return TRUE;
+}
@@ -0,0 +1,91 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef __ARCHIVE_H
+#define __ARCHIVE_H
+
+
+#include <stdio.h>
+#include "Index.h"
+
+
+#ifndef FALSE
+#define FALSE                 0
+#endif
+#ifndef TRUE
+#define TRUE                  1
+#endif
+
+#define ARCHIVE_MAGIC         "EPP2ARC1"
+#define ARCHIVE_MAGIC_SIZE    8
+#define ARCHIVE_NAME_SIZE     255
+// Chunk sizes of the content defined chunking, a chunk ends where the top
+// bits of the rolling hash are 0, on average every 1 KB past the minimum.
+#define ARCHIVE_MIN_CHUNK     0x100
+#define ARCHIVE_MAX_CHUNK     0x1000
+#define ARCHIVE_CHUNK_MASK    0xFFC0000000000000ULL
+#define ARCHIVE_GEAR_SEED     0x45505032ULL
+// Record types of the archive file.
+#define ARCHIVE_CHUNK         'C'
+#define ARCHIVE_IMAGE         'I'
+
+
+typedef struct
+{
+   IndexHashType Hash;
+   long Position;
+   unsigned long Length;
+} ArchiveChunkType;
+
+
+typedef struct
+{
+   char Name[ARCHIVE_NAME_SIZE + 1];
+   unsigned long Start;
+   unsigned long Size;
+   // Chunks of the image in address order, and the offset of each in the image.
+   unsigned long ChunkCount;
+   unsigned long* Chunks;
+   unsigned long* Offsets;
+} ArchiveImageType;
+
+
+typedef struct
+{
+   FILE* File;
+   unsigned long ChunkCount;
+   unsigned long ChunkSpace;
+   ArchiveChunkType* Chunks;
+   // Hash table of the chunks, each slot the chunk number + 1, 0 when free.
+   unsigned long SlotCount;
+   unsigned long* Slots;
+   unsigned long ImageCount;
+   ArchiveImageType* Images;
+   // Bytes of chunk data in the file.
+   unsigned long Stored;
+} ArchiveType;
+
+
+short ArchiveOpen(ArchiveType* Archive, char* FileName);
+void ArchiveClose(ArchiveType* Archive);
+unsigned long ArchiveCut(unsigned char* Data, unsigned long Length);
+short ArchiveAdd(ArchiveType* Archive, char* Name, unsigned char* Data, unsigned long Start, unsigned long Size, unsigned long* NewBytes);
+ArchiveImageType* ArchiveFind(ArchiveType* Archive, char* Name);
+short ArchiveRead(ArchiveType* Archive, ArchiveImageType* Image, unsigned long Start, unsigned long End, unsigned char* Data);
+
+
+#endif
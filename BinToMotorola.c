@@ -27,7 +27,8 @@
 /* The utility AddBinToROM can be used to create a ROM image with binary    */
 /* resources at their required address location. This can also be used to   */
 /* locate data to be added to a pre-programmed EPROM at an unprogrammed     */
-/* location.                                                                */
+/* location. The number of data bytes in each record can be specified, the  */
+/* EPP-2_PROG K operation measures the fastest record size for a link.      */
 /****************************************************************************/
 
 
@@ -41,8 +42,13 @@
 #define ARG_START_ADR      1
 #define ARG_MAX_ADR        2
 #define ARG_HEX_FILE       3
+#define ARG_RECORD_SIZE    4
 
 #define BUFF_SIZE          255
+#define RECORD_SIZE        32
+// Most data bytes in an S3 record which fits a line of 255 characters,
+// the longest line EPP-2_PROG sends.
+#define MAX_RECORD_SIZE    119
 
 
 int main(int argc, char* argv[])
@@ -52,13 +58,16 @@ int main(int argc, char* argv[])
    unsigned char Data;
    unsigned char CheckSum;
    unsigned int Count;
+   unsigned int RecordSize = RECORD_SIZE;
    unsigned long Address = 0x0000;
    unsigned long MaxAddress = 0xFFFF;
    char Hex[BUFF_SIZE + 1];
    char Buffer[BUFF_SIZE + 1];
 
-   if (argc != ARG_COUNT)
-      printf("\n%s [START_ADR] [MAX_ADR] [BIN_FILE]\n\n", argv[ARG_EXE]);
+   if (argc > ARG_RECORD_SIZE)
+      RecordSize = atoi(argv[ARG_RECORD_SIZE]);
+   if (argc < ARG_COUNT || argc > ARG_COUNT + 1 || RecordSize < 1 || RecordSize > MAX_RECORD_SIZE)
+      printf("\n%s [START_ADR] [MAX_ADR] [BIN_FILE] <RECORD_SIZE>\n\n", argv[ARG_EXE]);
    else
    {
   /*******************************/
@@ -90,12 +99,12 @@ int main(int argc, char* argv[])
             while (!feof(File) && Address < MaxAddress && Address <= 0xFFFFFFFF)
             {
    /***************************************************************/
-  /* Each line of a Motorola S recored file is 32 bytes of data, */
+  /* Each line of a Motorola S recored file is RecordSize bytes, */
  /* and accumulate a checksum for the line of data.             */
 /***************************************************************/
                CheckSum = 0;
                Buffer[0] = '\0';
-               for (Count = 0; Count < 32 && !feof(File); ++Count)
+               for (Count = 0; Count < RecordSize && !feof(File); ++Count)
                {
                   Data = fgetc(File);
                   CheckSum += Data;
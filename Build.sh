@@ -16,6 +16,15 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-gcc AddBinToROM.c -o AddBinToROM
+gcc -c Image.c Index.c Progress.c Session.c Trace.c Preflight.c Estimate.c Log.c Schedule.c Metrics.c Archive.c
+ar rcs libEPP-2.a Image.o Index.o Progress.o Session.o Trace.o Preflight.o Estimate.o Log.o Schedule.o Metrics.o Archive.o
+
+gcc AddBinToROM.c libEPP-2.a -lpthread -o AddBinToROM
 gcc BinToMotorola.c -o BinToMotorola
-gcc EPP-2_PROG.c -o EPP-2_PROG
+gcc MergeMotorola.c libEPP-2.a -lpthread -o MergeMotorola
+gcc EPP-2_PROG.c libEPP-2.a -lpthread -o EPP-2_PROG
+gcc ROMIndex.c libEPP-2.a -lpthread -o ROMIndex
+gcc ROMArchive.c libEPP-2.a -lpthread -o ROMArchive
+gcc ImageDiff.c libEPP-2.a -lpthread -o ImageDiff
+gcc SplitROM.c libEPP-2.a -lpthread -o SplitROM
+gcc TraceReplay.c libEPP-2.a -lpthread -o TraceReplay
@@ -0,0 +1,96 @@
+#!/bin/bash
+
+# EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+# Copyright (C) 2024 Jason Birch
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Check the file utilities without an EPP-2 Programmer, after ./Build.sh:
+# the archive round trip, an archive cut short, merging files and the
+# check of a file before it is programmed. Exits 1 if any check failed.
+
+BIN=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK"
+PASSED=0
+FAILED=0
+
+# Check NAME COMMAND... - the command must succeed.
+Check()
+{
+   local Name=$1
+   shift
+   if "$@" > LOG 2>&1
+   then
+      echo "PASSED: $Name"
+      PASSED=$((PASSED + 1))
+   else
+      echo "FAILED: $Name"
+      sed 's/^/        /' LOG
+      FAILED=$((FAILED + 1))
+   fi
+}
+
+# Rejected FILE - EPP-2_PROG refuses FILE before using a port.
+Rejected()
+{
+   "$BIN/EPP-2_PROG" --estimate W 269896 0000 "$1" 2>&1 | grep "FILE CHECK FAILED"
+}
+
+# Accepted FILE - EPP-2_PROG estimates FILE without refusing it.
+Accepted()
+{
+   ! Rejected "$1"
+}
+
+# Two revisions of a 16 KB image, the second with 16 bytes changed.
+head -c 16384 /dev/urandom > ROM_A.BIN
+cp ROM_A.BIN ROM_B.BIN
+head -c 16 /dev/urandom | dd of=ROM_B.BIN bs=1 seek=8192 conv=notrunc 2> /dev/null
+head -c 4096 ROM_A.BIN | tail -c 2048 > RANGE.BIN
+
+# Archive: add, export and compare.
+"$BIN/ROMArchive" A ROM.ARC ROM_A.BIN A > /dev/null
+"$BIN/ROMArchive" A ROM.ARC ROM_B.BIN B > /dev/null
+Check "ARCHIVE EXPORT BINARY" eval '"$BIN/ROMArchive" B ROM.ARC A A.BIN && cmp ROM_A.BIN A.BIN'
+Check "ARCHIVE EXPORT REVISION" eval '"$BIN/ROMArchive" B ROM.ARC B B.BIN && cmp ROM_B.BIN B.BIN'
+Check "ARCHIVE EXPORT S RECORDS" eval '"$BIN/ROMArchive" M ROM.ARC A A.HEX && "$BIN/ImageDiff" ROM_A.BIN A.HEX'
+Check "ARCHIVE EXPORT RANGE" eval '"$BIN/ROMArchive" B ROM.ARC A R.BIN 800 FFF && cmp RANGE.BIN R.BIN'
+Check "ARCHIVE STORES SHARED DATA ONCE" test $(stat -c %s ROM.ARC) -lt 24576
+
+# Archive cut short while adding the last image.
+head -c $(($(stat -c %s ROM.ARC) - 7)) ROM.ARC > CUT.ARC
+Check "CUT ARCHIVE KEEPS EARLIER IMAGE" eval '"$BIN/ROMArchive" B CUT.ARC A CUT_A.BIN && cmp ROM_A.BIN CUT_A.BIN'
+Check "CUT ARCHIVE DROPS PART IMAGE" eval '"$BIN/ROMArchive" B CUT.ARC B CUT_B.BIN; test ! -e CUT_B.BIN'
+Check "CUT ARCHIVE ADDS AGAIN" eval '"$BIN/ROMArchive" A CUT.ARC ROM_B.BIN B && "$BIN/ROMArchive" B CUT.ARC B CUT_B.BIN && cmp ROM_B.BIN CUT_B.BIN'
+
+# Merge: halves into one file, and revisions which overlap.
+"$BIN/ROMArchive" M ROM.ARC A LOW.HEX 0 1FFF > /dev/null
+"$BIN/ROMArchive" M ROM.ARC A HIGH.HEX 2000 3FFF > /dev/null
+"$BIN/ROMArchive" M ROM.ARC B B.HEX > /dev/null
+Check "MERGE HALVES" eval '"$BIN/MergeMotorola" E M.HEX HIGH.HEX LOW.HEX && "$BIN/ImageDiff" ROM_A.BIN M.HEX'
+Check "MERGE DIFFERING OVERLAP IS AN ERROR" eval '! "$BIN/MergeMotorola" E AB.HEX A.HEX B.HEX'
+Check "MERGE FIRST FILE WINS" eval '"$BIN/MergeMotorola" F AB.HEX A.HEX B.HEX && "$BIN/ImageDiff" ROM_A.BIN AB.HEX'
+Check "MERGE LAST FILE WINS" eval '"$BIN/MergeMotorola" L AB.HEX A.HEX B.HEX && "$BIN/ImageDiff" ROM_B.BIN AB.HEX'
+
+# Check of a file before it is programmed.
+sed -n '1p' M.HEX | cat M.HEX - > AFTER_END.HEX
+sed '1s/..\r\?$/00/' M.HEX > BAD_SUM.HEX
+Check "PREFLIGHT ACCEPTS MERGED FILE" Accepted M.HEX
+Check "PREFLIGHT DATA AFTER TERMINATION" Rejected AFTER_END.HEX
+Check "PREFLIGHT RECORD CHECKSUM" Rejected BAD_SUM.HEX
+
+echo "$((PASSED + FAILED)) CHECKS, $PASSED PASSED, $FAILED FAILED"
+[ $FAILED -eq 0 ]
@@ -29,41 +29,76 @@
 
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
 #include <ctype.h>
-#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <strings.h>
 #include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
 #include <string.h>
-#include <termios.h>
+#include "Session.h"
+#include "Index.h"
+#include "Preflight.h"
+#include "Estimate.h"
+#include "Schedule.h"
 #include "EPP-2_PROG.h"
 
 
 
 int main(int argc, char* argv[])
 {
-   FILE* File;
    short Count;
-   short TryCount;
-   short Result;
+   short RangeCount = 0;
+   short EstimateOnly = FALSE;
+   short Passed;
    int DeviceCode;
-   int SerialPort;
+   unsigned long Offset = 0;
+   unsigned long Status[STATUS_COUNT];
+   double StartTime;
    char Buffer[BUFF_SIZE + 1];
-   struct termios tty;
    ConfigType Config;
+   SessionType Session;
+   ImageType Image;
+   IndexType Index;
+   RangeType Ranges[RANGE_MAX];
+   EstimateType Estimate;
+   ScheduleType Schedule;
+
+   // With --estimate the operation is estimated, without using the port.
+   if (argc > ARG_OPERATION && !strcmp(argv[ARG_OPERATION], "--estimate"))
+   {
+      EstimateOnly = TRUE;
+      argv[ARG_OPERATION] = argv[ARG_EXE];
+      ++argv;
+      --argc;
+   }
 
   /*******************************************/
  /* Check for valid command line arguments. */
 /*******************************************/
    if (argc < 3 || argc > ARG_COUNT
-      || !strchr("DSERWV", argv[ARG_OPERATION][0])
+      || !strchr("DSERWVCIBKMJFL", argv[ARG_OPERATION][0])
+      || (EstimateOnly && !strchr("ERWV", argv[ARG_OPERATION][0]))
       || (argv[ARG_OPERATION][0] == 'D' && argc < 2)
-      || (argv[ARG_OPERATION][0] == 'S' && argc != 3)
-      || ((argv[ARG_OPERATION][0] == 'W' || argv[ARG_OPERATION][0] == 'V') && argc != 5))
+      || (strchr("SIJ", argv[ARG_OPERATION][0]) && argc != 3)
+      || (strchr("WVCBKMFL", argv[ARG_OPERATION][0]) && argc != 5))
    {
       fprintf(stderr, "\r\n");
       fprintf(stderr, "EPP-2 EPROM Programmer Linux Application V1.01 (C)2024-01-08 Jason Birch\r\n\r\n");
-      fprintf(stderr, "%s [D|S|E|R|W|V] [DEVICE] <START_ADR> <END_ADR>\r\n", argv[ARG_EXE]);
-      fprintf(stderr, "%s [D|S|E|R|W|V] [DEVICE] [START_ADR] [MOTOROLA_FILE]\r\n", argv[ARG_EXE]);
+      fprintf(stderr, "%s [D|S|E|R] [DEVICE] <START_ADR> <END_ADR>\r\n", argv[ARG_EXE]);
+      fprintf(stderr, "%s [D|S|E|R|W|V|C|B] [DEVICE] [START_ADR] [MOTOROLA_FILE]\r\n", argv[ARG_EXE]);
+      fprintf(stderr, "%s [E|R] [DEVICE] [RANGES]\r\n", argv[ARG_EXE]);
+      fprintf(stderr, "%s [V] [DEVICE] [RANGES] [MOTOROLA_FILE]\r\n", argv[ARG_EXE]);
+      fprintf(stderr, "%s [I] [DEVICE]\r\n", argv[ARG_EXE]);
+      fprintf(stderr, "%s [K] [DEVICE] [START_ADR] [END_ADR]\r\n", argv[ARG_EXE]);
+      fprintf(stderr, "%s [M] [DEVICE] [START_ADR] [FILE]\r\n", argv[ARG_EXE]);
+      fprintf(stderr, "%s [F] [DEVICE] [START_ADR] [MOTOROLA_FILE]\r\n", argv[ARG_EXE]);
+      fprintf(stderr, "%s [L] [DEVICE] [START_ADR] [MOTOROLA_FILE]\r\n", argv[ARG_EXE]);
+      fprintf(stderr, "%s [J] [JOB_FILE]\r\n", argv[ARG_EXE]);
+      fprintf(stderr, "%s --estimate [E|R|W|V] ...\r\n", argv[ARG_EXE]);
       fprintf(stderr, "\r\n");
       fprintf(stderr, "WHERE:\r\n");
       fprintf(stderr, "[D] <NAME>                          - EPROM Device/Manufacturer name search.\r\n");
@@ -72,6 +107,17 @@ int main(int argc, char* argv[])
       fprintf(stderr, "[R] [DEVICE] <START_ADR> <END_ADR>  - Read data in address range.\r\n");
       fprintf(stderr, "[W] [DEVICE] [START_ADR] [MOTOROLA] - Write data in address range.\r\n");
       fprintf(stderr, "[V] [DEVICE] [START_ADR] [MOTOROLA] - Verify data in address range.\r\n");
+      fprintf(stderr, "[C] [DEVICE] [START_ADR] [MOTOROLA] - Checksum confirm after W or V, else full verify.\r\n");
+      fprintf(stderr, "[B] [DEVICE] [START_ADR] [MOTOROLA] - Locate differences by reading the device.\r\n");
+      fprintf(stderr, "[I] [DEVICE]                        - Identify device data from the index of known images.\r\n");
+      fprintf(stderr, "[K] [DEVICE] [START_ADR] [END_ADR]  - Calibrate baud rate & record size on an empty range.\r\n");
+      fprintf(stderr, "[M] [DEVICE] [START_ADR] [FILE]     - Watch a file or .MAN manifest, write changed records.\r\n");
+      fprintf(stderr, "[F] [DEVICE] [START_ADR] [MOTOROLA] - Read to the device end in chunks, resuming a broken read.\r\n");
+      fprintf(stderr, "[L] [DEVICE] [START_ADR] [MOTOROLA] - Program one device after another, LOOP_STEPS on each.\r\n");
+      fprintf(stderr, "[J] [JOB_FILE]                      - Run the jobs of a file on every EPP-2 of SERIAL_PORTS.\r\n");
+      fprintf(stderr, "--estimate                          - Estimate the time of E, R, W or V, without the port.\r\n");
+      fprintf(stderr, "[RANGES] START-END,START-END,...     - List of address ranges, or\r\n");
+      fprintf(stderr, "         @MOTOROLA                   - Populated ranges of a Motorola file.\r\n");
       fprintf(stderr, "\r\n");
    }
    else
@@ -79,37 +125,25 @@ int main(int argc, char* argv[])
   /**********************************/
  /* Read configuration paramaters. */
 /**********************************/
-      strcpy(Config.SerialPort, "/dev/ttyUSB0");
-      strcpy(Config.BaudRate, "19200");
-      if (!(File = fopen("EPP-2_PROG.CFG", "rt")))
-         fprintf(stderr, "USING DEFAULT CONFIG VALUES, FAILED TO OPEN CONFIG FILE FOR READING: EPP-2_PROG.CFG\r\n");
-      else
-      {
-         while (fgets(Buffer, BUFF_SIZE, File))
-         {
-            while (Buffer[0] != '\0' && (Buffer[strlen(Buffer)-1] == '\r' || Buffer[strlen(Buffer)-1] == '\n'))
-            {
-               Buffer[strlen(Buffer)-1] = '\0';
-            };
-            if (!strncmp(Buffer, "SERIAL_PORT=", 12))
-               strcpy(Config.SerialPort, &(Buffer[12]));
-            else if (!strncmp(Buffer, "BAUD_RATE=", 10))
-               strcpy(Config.BaudRate, &(Buffer[10]));
-         };
-         fclose(File);
-      }
-      fprintf(stderr, "\r\nCONFIGURATION\r\n");
-      fprintf(stderr, "=============\r\n");
-      fprintf(stderr, "SERIAL PORT: %s\r\n", Config.SerialPort);
-      fprintf(stderr, "BAUD RATE: %s\r\n", Config.BaudRate);
+      if (!ConfigRead(&Config, "EPP-2_PROG.CFG"))
+         LogPrint(LOG_ERROR, "USING DEFAULT CONFIG VALUES, FAILED TO OPEN CONFIG FILE FOR READING: EPP-2_PROG.CFG\r\n");
+      // From here messages are written to stderr by a thread of their own.
+      LogLevel = Config.LogLevel;
+      LogStart(stderr);
+      if (!MetricsStart(Config.MetricsFile, Config.MetricsSocket))
+         LogPrint(LOG_ERROR, "Failed to start metrics: %s %s\r\n", Config.MetricsFile, Config.MetricsSocket);
+      LogPrint(LOG_INFO, "\r\nCONFIGURATION\r\n");
+      LogPrint(LOG_INFO, "=============\r\n");
+      LogPrint(LOG_INFO, "SERIAL PORT: %s\r\n", Config.SerialPort);
+      LogPrint(LOG_INFO, "BAUD RATE: %s\r\n", Config.BaudRate);
 
   /******************************************/
  /* EPROM Device/Manufacturer name search. */
 /******************************************/
       if (argv[ARG_OPERATION][0] == 'D' && argc < 4)
       {
-         fprintf(stderr, "\r\n%-6s : %-20s %-20s\r\n", "CODE", "MANUFACTURER", "DEVICE");
-         fprintf(stderr, "====== : ==================== ====================\r\n");
+         LogPrint(LOG_INFO, "\r\n%-6s : %-20s %-20s\r\n", "CODE", "MANUFACTURER", "DEVICE");
+         LogPrint(LOG_INFO, "====== : ==================== ====================\r\n");
          // Search performed in all upper case characters.
          for (Count = 0; Count < strlen(argv[ARG_DEVICE]); ++Count)
             Buffer[Count] = toupper(argv[ARG_DEVICE][Count]);
@@ -118,10 +152,10 @@ int main(int argc, char* argv[])
          while (Devices[Count][0][0] != '\0')
          {
             if (argv[ARG_DEVICE] == NULL || strstr(Devices[Count][0], Buffer) || strstr(Devices[Count][1], Buffer) || strstr(Devices[Count][2], Buffer))
-               fprintf(stderr, "%-6s : %-20s %-20s\r\n", Devices[Count][2], Devices[Count][0], Devices[Count][1]);
+               LogPrint(LOG_INFO, "%-6s : %-20s %-20s\r\n", Devices[Count][2], Devices[Count][0], Devices[Count][1]);
             ++Count;
          };
-         fprintf(stderr, "\r\n");
+         LogPrint(LOG_INFO, "\r\n");
       }
   /*******************************************/
  /* EPROM Device Programming Specification. */
@@ -129,456 +163,1653 @@ int main(int argc, char* argv[])
       else if (argv[ARG_OPERATION][0] == 'S' && argc == 3)
       {
          sscanf(argv[ARG_DEVICE], "%X", &DeviceCode);
-         fprintf(stderr, "\r\nDEVICE CODE   : %6.6X\r\n", DeviceCode);
-         fprintf(stderr, "EPROM Size    : %s\r\n", EPROM_Size[(DeviceCode >> 0) & 0x0F]);
-         fprintf(stderr, "Pin Config    : %s\r\n", PinConfig[(DeviceCode >> 4) & 0x07]);
-         fprintf(stderr, "FF Skip       : %s\r\n", FF_Skip[(DeviceCode >> 7) & 0x01]);
-         fprintf(stderr, "Vpp           : %s\r\n", Vpp[(DeviceCode >> 8) & 0x0F]);
-         fprintf(stderr, "Vcc           : %s\r\n", Vpp[(DeviceCode >> 12) & 0x03]);
-         fprintf(stderr, "Margin Factor : %s\r\n", MarginFactor[(DeviceCode >> 14) & 0x03]);
-         fprintf(stderr, "Pulse Time    : %s\r\n", PulseTime[(DeviceCode >> 16) & 0x0F]);
-         fprintf(stderr, "Algorithm     : %s\r\n", Algorithms[(DeviceCode >> 20) & 0x03]);
-         fprintf(stderr, "\r\n");
+         LogPrint(LOG_INFO, "\r\nDEVICE CODE   : %6.6X\r\n", DeviceCode);
+         LogPrint(LOG_INFO, "EPROM Size    : %s\r\n", EPROM_Size[(DeviceCode >> 0) & 0x0F]);
+         LogPrint(LOG_INFO, "Pin Config    : %s\r\n", PinConfig[(DeviceCode >> 4) & 0x07]);
+         LogPrint(LOG_INFO, "FF Skip       : %s\r\n", FF_Skip[(DeviceCode >> 7) & 0x01]);
+         LogPrint(LOG_INFO, "Vpp           : %s\r\n", Vpp[(DeviceCode >> 8) & 0x0F]);
+         LogPrint(LOG_INFO, "Vcc           : %s\r\n", Vpp[(DeviceCode >> 12) & 0x03]);
+         LogPrint(LOG_INFO, "Margin Factor : %s\r\n", MarginFactor[(DeviceCode >> 14) & 0x03]);
+         LogPrint(LOG_INFO, "Pulse Time    : %s\r\n", PulseTime[(DeviceCode >> 16) & 0x0F]);
+         LogPrint(LOG_INFO, "Algorithm     : %s\r\n", Algorithms[(DeviceCode >> 20) & 0x03]);
+         LogPrint(LOG_INFO, "\r\n");
       }
-  /**********************************/
- /* Open Linux serial port device. */
-/**********************************/
-      else if (!(SerialPort = open(Config.SerialPort, O_RDWR)))
-         fprintf(stderr, "Failed to open serial port: %s\n", Config.SerialPort);
-      else
+  /****************************************************/
+ /* Get the address range list for E, R & V, if any. */
+/****************************************************/
+      else if (strchr("ERV", argv[ARG_OPERATION][0]) && argc > ARG_START_ADR
+         && (RangeCount = ParseRanges(argv[ARG_START_ADR], Ranges, RANGE_MAX)) < 0)
+         LogPrint(LOG_ERROR, "INVALID ADDRESS RANGE LIST: %s\r\n", argv[ARG_START_ADR]);
+  /**************************************************************/
+ /* Check the whole file fits the device, before using a port. */
+/**************************************************************/
+      else if (strchr("WVCB", argv[ARG_OPERATION][0])
+         && (sscanf(argv[ARG_DEVICE], "%X", &DeviceCode) != 1
+         || !PreflightMotorola(argv[ARG_DATA_FILE], (!RangeCount && sscanf(argv[ARG_START_ADR], "%lX", &Offset) == 1) ? Offset : 0,
+            DeviceSize(DeviceCode) ? DeviceSize(DeviceCode) : IMAGE_MAX_SIZE)))
+         LogPrint(LOG_ERROR, "FILE CHECK FAILED, DEVICE NOT USED: %s\r\n", argv[ARG_DATA_FILE]);
+   /*************************************************************/
+  /* Load the image to be written or verified, before using    */
+ /* the port, for the checksum and the progress of the file.  */
+/*************************************************************/
+      else if (strchr("WVCB", argv[ARG_OPERATION][0]) && !ImageCreate(&Image))
+         LogPrint(LOG_ERROR, "Failed to allocate memory for the image\r\n");
+      else if (strchr("WVCB", argv[ARG_OPERATION][0])
+         && ((!RangeCount && sscanf(argv[ARG_START_ADR], "%lX", &Offset) != 1)
+         || !ImageLoadMotorola(&Image, argv[ARG_DATA_FILE], Offset)
+         || !Image.ByteCount))
       {
-  /*****************************************/
- /* Read Linux serial port configuration. */
-/*****************************************/
-         if (tcgetattr(SerialPort, &tty))
-            fprintf(stderr, "Failed to get communication paramaters: %s\n", Config.SerialPort);
+         LogPrint(LOG_ERROR, "NO DATA IN MOTOROLA FILE: %s\r\n", argv[ARG_DATA_FILE]);
+         ImageFree(&Image);
+      }
+  /***********************************************/
+ /* Load the index of known images to identify. */
+/***********************************************/
+      else if (argv[ARG_OPERATION][0] == 'I' && !IndexLoad(&Index, Config.IndexFile))
+         LogPrint(LOG_ERROR, "NO INDEX OF KNOWN IMAGES: %s\r\n", Config.IndexFile);
+  /*********************************************************/
+ /* Estimate the time of the operation, without the port. */
+/*********************************************************/
+      else if (EstimateOnly)
+      {
+         EstimateOperation(&Estimate, argc, argv, &Image, Ranges, RangeCount, &Config);
+         printf("ESTIMATE %c %6.6X %d BAUD %lu BYTES\r\n", Estimate.Operation, Estimate.DeviceCode, Estimate.BaudRate, Estimate.Bytes);
+         printf("SETUP    %8.1f s\r\n", Estimate.Setup);
+         printf("TRANSFER %8.1f s %lu CHARACTERS\r\n", Estimate.Transfer, Estimate.Characters);
+         printf("DEVICE   %8.1f s %lu BYTES PROGRAMMED\r\n", Estimate.Device, Estimate.ProgramBytes);
+         printf("MODEL    %8.1f s\r\n", Estimate.Model);
+         if (!Estimate.Runs)
+            printf("NOT CALIBRATED, NO RUNS OF %c IN %s\r\n", Estimate.Operation, ESTIMATE_FILE);
          else
+            printf("CALIBRATION x%.2f FROM %lu RUNS OF %c%s\r\n", Estimate.Factor, Estimate.Runs, Estimate.Operation, Estimate.Average ? " WITH OTHER DEVICES" : "");
+         printf("TIME     %8.1f s\r\n", Estimate.Time);
+         if (strchr("WVCB", argv[ARG_OPERATION][0]))
+            ImageFree(&Image);
+      }
+  /**************************************************************/
+ /* Run the jobs of a job file on every EPP-2 of SERIAL_PORTS. */
+/**************************************************************/
+      else if (argv[ARG_OPERATION][0] == 'J')
+      {
+         if (ScheduleRead(&Schedule, argv[ARG_JOB_FILE]))
          {
-  /********************************/
- /* Configure Linux serial port. */
-/********************************/
-            // Disable parity bit.
-            tty.c_cflag &= ~PARENB;
-            // One stop bit.
-            tty.c_cflag &= ~CSTOPB;
-            // Eight data bits.
-            tty.c_cflag |= CS8;
-            // Enable hardware handshaking.
-            tty.c_cflag |= CRTSCTS;
-            // Disable modem controls.
-            tty.c_cflag |= CREAD | CLOCAL;
-
-            // Enable sending each character, not just at a carrage return.
-            tty.c_lflag &= ~ICANON;
-            // Disable echo.
-            tty.c_lflag &= ~(ECHO | ECHOE | ECHONL);
-            // Disable signal characters.
-            tty.c_lflag &= ~ISIG;
-
-            // Disable software flow control.
-            tty.c_iflag &= ~(IXON | IXOFF | IXANY);
-            // Disable special bytes.
-            tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL);
-            tty.c_oflag &= ~(OPOST | ONLCR);
-            
-            // Set timeout.
-            tty.c_cc[VTIME] = 0;
-            tty.c_cc[VMIN] = 0;
-
-            // Set local baud rate.
-            SelectBaudRate(&tty, Config.BaudRate);
-
-  /******************************************/
- /* Write Linux serial port configuration. */
-/******************************************/
-            if (tcsetattr(SerialPort, TCSANOW, &tty))
-               fprintf(stderr, "Failed to set communication paramaters: %s\n", Config.SerialPort);
-
-   /**********************************************/
-  /* Check communication, configure remote baud */
- /* rate if remote command prompt not present. */
-/**********************************************/
-            do
+            if (ScheduleUnits(&Schedule, &Config))
             {
-               fprintf(stderr, "\r\nCHECK FOR COMMAND PROMT\r\n");
-               fprintf(stderr, "=======================\r\n");
-               // Check for remote command prompt.
-               sprintf(Buffer, "%c\r", 0x1B);
-               SendData(FALSE, SerialPort, Buffer);
-               sleep(1);
-               Result = ReceiveData(FALSE, SerialPort, Buffer, 1024, stderr);
-               if (Result != PROMPT)
-               {
-  /************************************************************/
- /* Set local baud rate to EPP-2 default power on baud rate. */
-/************************************************************/
-                  fprintf(stderr, "\r\nSET EPP-2 BAUD: %s\r\n", Config.BaudRate);
-                  fprintf(stderr, "=====================\r\n");
-  /***************************/
- /* Find current baud rate. */
-/***************************/
-                  Count = 0;
-                  do
-                  {
-                     // Set local baud rate to default for EPP-2, 9600.
-                     SelectBaudRate(&tty, BaudRates[Count]);
-                     if (tcsetattr(SerialPort, TCSANOW, &tty))
-                        fprintf(stderr, "Failed to set communication paramaters: %s\n", Config.SerialPort);
-  /******************************************************/
- /* Send cancel current command, ESC [0x1B], to EPP-2. */
-/******************************************************/
-                     TryCount = 0;
-                     do
-                     {
-                        // Clear send buffer.
-                        sprintf(Buffer, "%c\r", 0x1B);
-                        SendData(TRUE, SerialPort, Buffer);
-                        // Clear receive buffer.
-                        Result = ReceiveData(TRUE, SerialPort, Buffer, 128, stderr);
-                     } while (Result != PROMPT && ++TryCount < 4);
-                     if (Result == PROMPT)
-                     {
-                        fprintf(stderr, "CURRENT BAUD RATE: %s\r\n", BaudRates[Count]);
-                        break;
-                     }
-                  } while (BaudRates[++Count]);
-                  // Set remote baud rate to configuration baud rate.
-                  if (!strcmp(Config.BaudRate, "300"))
-                     SendData(FALSE, SerialPort, "6X\r");
-                  else if (!strcmp(Config.BaudRate, "600"))
-                     SendData(FALSE, SerialPort, "5X\r");
-                  else if (!strcmp(Config.BaudRate, "1200"))
-                     SendData(FALSE, SerialPort, "4X\r");
-                  else if (!strcmp(Config.BaudRate, "2400"))
-                     SendData(FALSE, SerialPort, "3X\r");
-                  else if (!strcmp(Config.BaudRate, "4800"))
-                     SendData(FALSE, SerialPort, "2X\r");
-                  else if (!strcmp(Config.BaudRate, "9600"))
-                     SendData(FALSE, SerialPort, "1X\r");
-                  else if (!strcmp(Config.BaudRate, "19200"))
-                     SendData(FALSE, SerialPort, "0X\r");
-                  else
-                     fprintf(stderr, "INVALID BAUD RATE FOR EPP-2 PROGRAMMER: %s\r\n", Config.BaudRate);
-                  sleep(1);
-  /***************************************************/
- /* Set local baud rate to configuration baud rate. */
-/***************************************************/
-                  // Set local baud rate.
-                  SelectBaudRate(&tty, Config.BaudRate);
-                  if (tcsetattr(SerialPort, TCSANOW, &tty))
-                     fprintf(stderr, "Failed to set communication paramaters: %s\n", Config.SerialPort);
-  /********************************************************/
- /* Send return to EPP-2 and check for a command prompt. */
-/********************************************************/
-                  WaitForPrompt(SerialPort);
-               }
-            } while (Result != PROMPT);
+               ScheduleAssign(&Schedule);
+               ScheduleRun(&Schedule);
+            }
+            ScheduleFree(&Schedule);
+         }
+      }
+  /***************************************/
+ /* Open and configure the serial port. */
+/***************************************/
+      else if (SessionOpen(&Session, &Config))
+      {
+         StartTime = ProgressTime();
+         MetricsBegin(Session.Metrics, argv[ARG_OPERATION][0]);
+         Estimate.Bytes = 0;
+         if (SessionHandshake(&Session) && Operation(&Session, argc, argv, &Image, Ranges, RangeCount, &Index))
+         {
+            StartTime = ProgressTime() - StartTime;
+  /*********************************************************/
+ /* Display the EPP-2 status at the end of the operation. */
+/*********************************************************/
+            LogPrint(LOG_INFO, "\r\nEEP-2 STATUS\n");
+            LogPrint(LOG_INFO, "============\n");
+            Passed = SessionStatus(&Session, Status) && !Status[STATUS_ERROR];
+            if (strchr("ERWV", argv[ARG_OPERATION][0]))
+               EstimateOperation(&Estimate, argc, argv, &Image, Ranges, RangeCount, &Session.Config);
+            // A run without errors refines the estimate of the operation.
+            if (Passed && strchr("ERWV", argv[ARG_OPERATION][0]))
+               EstimateUpdate(&Estimate, ESTIMATE_FILE, StartTime);
+            MetricsOperation(Session.Metrics, argv[ARG_OPERATION][0], Passed, Estimate.Bytes, StartTime);
+         }
+         else
+            MetricsOperation(Session.Metrics, argv[ARG_OPERATION][0], FALSE, 0, ProgressTime() - StartTime);
+         SessionClose(&Session);
+         if (strchr("WVCB", argv[ARG_OPERATION][0]))
+            ImageFree(&Image);
+         if (argv[ARG_OPERATION][0] == 'I')
+            IndexFree(&Index);
+      }
+      else if (strchr("WVCB", argv[ARG_OPERATION][0]))
+         ImageFree(&Image);
+      else if (argv[ARG_OPERATION][0] == 'I')
+         IndexFree(&Index);
+      MetricsStop();
+      LogStop();
+   }
+}
+
+
+
+/******************************************************************/
+/* Configure the EPP-2 for the device and address range, then     */
+/* perform the operation. Returns FALSE if the EPP-2 replied with */
+/* an error while being configured.                               */
+/******************************************************************/
+short Operation(SessionType* Session, int argc, char* argv[], ImageType* Image, RangeType* Ranges, short RangeCount, IndexType* Index)
+{
+   short RangeIndex;
+   short Match;
+   unsigned long Total;
+   unsigned long CheckSum;
+   unsigned long Status[STATUS_COUNT];
+   char Buffer[BUFF_SIZE + 1];
+   ProgressType Progress;
 
   /**************************************************/
  /* Configure the EPP-2 for the device to be used. */
 /**************************************************/
-            fprintf(stderr, "\r\nSET DEVICE CODE: %s\r\n", argv[ARG_DEVICE]);
-            fprintf(stderr, "================\r\n");
-            sprintf(Buffer, "%sS\r", argv[ARG_DEVICE]);
-            SendData(FALSE, SerialPort, Buffer);
-            if (ReceiveData(FALSE, SerialPort, Buffer, 1024, stderr) == TRUE)
-               goto EPP_2_ERROR;
-
-            if (argc > ARG_START_ADR)
-            {
-               fprintf(stderr, "\r\nSET START ADDRESS\r\n");
-               fprintf(stderr, "=================\r\n");
-               sprintf(Buffer, "%sP\r", argv[ARG_START_ADR]);
-               SendData(FALSE, SerialPort, Buffer);
-               if (ReceiveData(FALSE, SerialPort, Buffer, 1024, stderr) == TRUE)
-                  goto EPP_2_ERROR;
-
-               fprintf(stderr, "\r\nSET OFFSET ADDRESS\r\n");
-               fprintf(stderr, "==================\r\n");
-               sprintf(Buffer, "%sO\r", argv[ARG_START_ADR]);
-               SendData(FALSE, SerialPort, Buffer);
-               if (ReceiveData(FALSE, SerialPort, Buffer, 1024, stderr) == TRUE)
-                  goto EPP_2_ERROR;
-            }
-            else
-            {
-               SendData(FALSE, SerialPort, "0000O\r");
-               if (ReceiveData(FALSE, SerialPort, Buffer, 1024, stderr) == TRUE)
-                  goto EPP_2_ERROR;
-            }
+   LogPrint(LOG_INFO, "\r\nSET DEVICE CODE: %s\r\n", argv[ARG_DEVICE]);
+   LogPrint(LOG_INFO, "================\r\n");
+   if (!SessionSelectDevice(Session, argv[ARG_DEVICE]))
+      return FALSE;
 
-            if (!strchr("WV", argv[ARG_OPERATION][0]))
-            {
-               if (argc > ARG_END_ADR)
-               {
-                  fprintf(stderr, "\r\nSET END ADDRESS\r\n");
-                  fprintf(stderr, "===============\r\n");
-                  sprintf(Buffer, "%sL\r", argv[ARG_END_ADR]);
-                  SendData(FALSE, SerialPort, Buffer);
-                  if (ReceiveData(FALSE, SerialPort, Buffer, 1024, stderr) == TRUE)
-                     goto EPP_2_ERROR;
-               }
-            }
+   if (argc > ARG_START_ADR && !RangeCount)
+   {
+      LogPrint(LOG_INFO, "\r\nSET START ADDRESS\r\n");
+      LogPrint(LOG_INFO, "=================\r\n");
+      if (!SessionSetStart(Session, strtoul(argv[ARG_START_ADR], NULL, 16)))
+         return FALSE;
 
-            fprintf(stderr, "\r\nGET ADDRESS RANGE\r\n");
-            fprintf(stderr, "=================\r\n");
-            SendData(FALSE, SerialPort, "SPLO\r");
-            if (ReceiveData(FALSE, SerialPort, Buffer, 1024, stderr) == TRUE)
-               goto EPP_2_ERROR;
+      LogPrint(LOG_INFO, "\r\nSET OFFSET ADDRESS\r\n");
+      LogPrint(LOG_INFO, "==================\r\n");
+      if (!SessionSetOffset(Session, strtoul(argv[ARG_START_ADR], NULL, 16)))
+         return FALSE;
+   }
+   else if (!SessionSetOffset(Session, 0))
+      return FALSE;
+
+   if (!strchr("WVCBMFL", argv[ARG_OPERATION][0]))
+   {
+      if (argc > ARG_END_ADR && !RangeCount)
+      {
+         LogPrint(LOG_INFO, "\r\nSET END ADDRESS\r\n");
+         LogPrint(LOG_INFO, "===============\r\n");
+         sprintf(Buffer, "%sL\r", argv[ARG_END_ADR]);
+         if (!SessionCommand(Session, Buffer))
+            return FALSE;
+      }
+   }
+
+   LogPrint(LOG_INFO, "\r\nGET ADDRESS RANGE\r\n");
+   LogPrint(LOG_INFO, "=================\r\n");
+   if (!SessionCommand(Session, "SPLO\r"))
+      return FALSE;
 
   /****************************************************************/
  /* Perform an empty check of the device over the address range. */
 /****************************************************************/
-            if (argv[ARG_OPERATION][0] == 'E')
-            {
-               fprintf(stderr, "\r\nEMPTY CHECK\n");
-               fprintf(stderr, "===========\n");
-               SendData(FALSE, SerialPort, "T\r");
-               WaitForPrompt(SerialPort);
-            }
+   if (argv[ARG_OPERATION][0] == 'E')
+   {
+      LogPrint(LOG_INFO, "\r\nEMPTY CHECK\n");
+      LogPrint(LOG_INFO, "===========\n");
+      if (!RangeCount)
+         SessionEmpty(Session);
+      for (RangeIndex = 0; RangeIndex < RangeCount; ++RangeIndex)
+      {
+         if (!SessionSetRange(Session, Ranges[RangeIndex].Start, Ranges[RangeIndex].End))
+            return FALSE;
+         if (!SessionEmpty(Session))
+         {
+            LogPrint(LOG_ERROR, "NOT EMPTY IN RANGE: %6.6lX - %6.6lX\r\n", Ranges[RangeIndex].Start, Ranges[RangeIndex].End);
+            break;
+         }
+      }
+   }
   /*****************************************************/
  /* Read data from the device over the address range. */
 /*****************************************************/
-            else if (argv[ARG_OPERATION][0] == 'R')
-            {
-               fprintf(stderr, "\r\nREAD DATA\n");
-               fprintf(stderr, "=========\n");
-               SendData(FALSE, SerialPort, "R\r");
-               ReceiveData(FALSE, SerialPort, Buffer, 1024, stdout);
-            }
+   else if (argv[ARG_OPERATION][0] == 'R')
+   {
+      LogPrint(LOG_INFO, "\r\nREAD DATA\n");
+      LogPrint(LOG_INFO, "=========\n");
+      Total = RangeTotal(argc, argv, Session->DeviceCode, Ranges, RangeCount);
+      ProgressStart(&Progress, "READ", Total, Session->Config.StatusFd);
+      if (!RangeCount)
+         SessionRead(Session, stdout, &Progress);
+      for (RangeIndex = 0; RangeIndex < RangeCount; ++RangeIndex)
+      {
+         if (!SessionSetRange(Session, Ranges[RangeIndex].Start, Ranges[RangeIndex].End))
+            return FALSE;
+         if (!RangeRead(Session, RangeIndex == 0, RangeIndex == RangeCount - 1, &Progress))
+         {
+            LogPrint(LOG_ERROR, "READ FAILED IN RANGE: %6.6lX - %6.6lX\r\n", Ranges[RangeIndex].Start, Ranges[RangeIndex].End);
+            break;
+         }
+      }
+      ProgressEnd(&Progress);
+   }
   /***************************************************/
  /* Write the Motorola S-Record file to the device. */
 /***************************************************/
-            else if (argv[ARG_OPERATION][0] == 'W')
-            {
-               fprintf(stderr, "\r\nWRITE DATA\r\n");
-               fprintf(stderr, "==========\r\n");
-               SendData(FALSE, SerialPort, "W\r");
-               Result = ReceiveData(FALSE, SerialPort, Buffer, 1024, stderr);
-               if (!(File = fopen(argv[ARG_DATA_FILE], "rt")))
-                  fprintf(stderr, "Failed to open Motorola S-Record file: %s\r\n", argv[ARG_DATA_FILE]);
-               else
-               {
-                  Result = FALSE;
-                  while (!feof(File) && !Result)
-                  {
-                     Buffer[0] = '\0';
-                     fgets(Buffer, BUFF_SIZE, File);
-                     if (Buffer[0] == 'S')
-                     {
-                        SendData(FALSE, SerialPort, Buffer);
-                        Result = ReceiveData(FALSE, SerialPort, Buffer, 8, stderr);
-                        if (Buffer[0] != '\0')
-                           break;
-                     }
-                  };
-                  fclose(File);
-                  WaitForPrompt(SerialPort);
-               }
-            }
+   else if (argv[ARG_OPERATION][0] == 'W')
+   {
+      LogPrint(LOG_INFO, "\r\nWRITE DATA\r\n");
+      LogPrint(LOG_INFO, "==========\r\n");
+      ProgressStart(&Progress, "WRITE", Image->ByteCount, Session->Config.StatusFd);
+      SessionWrite(Session, argv[ARG_DATA_FILE], 0, ADDRESS_MAX, &Progress);
+      ProgressEnd(&Progress);
+   }
   /*********************************************************/
  /* Verify the Motorola S-Record file to the device data. */
 /*********************************************************/
-            else if (argv[ARG_OPERATION][0] == 'V')
+   else if (argv[ARG_OPERATION][0] == 'V')
+   {
+      LogPrint(LOG_INFO, "\r\nVERIFY DATA\r\n");
+      LogPrint(LOG_INFO, "===========\r\n");
+      for (RangeIndex = 0, Total = RangeCount ? 0 : Image->ByteCount; RangeIndex < RangeCount; ++RangeIndex)
+         Total += ImageCount(Image, Ranges[RangeIndex].Start, Ranges[RangeIndex].End);
+      ProgressStart(&Progress, "VERIFY", Total, Session->Config.StatusFd);
+      if (!RangeCount)
+         SessionVerify(Session, argv[ARG_DATA_FILE], 0, ADDRESS_MAX, &Progress);
+      // Only the records inside each range are verified, in their own window.
+      for (RangeIndex = 0; RangeIndex < RangeCount; ++RangeIndex)
+      {
+         if (!SessionSetRange(Session, Ranges[RangeIndex].Start, Ranges[RangeIndex].End))
+            return FALSE;
+         SessionVerify(Session, argv[ARG_DATA_FILE], Ranges[RangeIndex].Start, Ranges[RangeIndex].End, &Progress);
+         if (SessionStatus(Session, Status) && Status[STATUS_ERROR])
+         {
+            LogPrint(LOG_ERROR, "VERIFY FAILED IN RANGE: %6.6lX - %6.6lX\r\n", Ranges[RangeIndex].Start, Ranges[RangeIndex].End);
+            break;
+         }
+      }
+      ProgressEnd(&Progress);
+   }
+   /********************************************************************/
+  /* Confirm the sumcheck of a W or V just run on the image with the  */
+ /* sumcheck of the image, otherwise perform a full verify.          */
+/********************************************************************/
+   else if (argv[ARG_OPERATION][0] == 'C')
+   {
+      LogPrint(LOG_INFO, "\r\nCHECKSUM VERIFY\r\n");
+      LogPrint(LOG_INFO, "===============\r\n");
+      CheckSum = ImageCheckSum(Image, Image->Start, Image->End);
+      if (!SessionSetRange(Session, Image->Start, Image->End))
+         return FALSE;
+      Match = FALSE;
+     /***************************************************************/
+    /* The G sumcheck is the running sum of the bytes processed by */
+   /* the preceding T, R, W or V command, setting P and L does    */
+  /* not recalculate it. It only stands for the image range when */
+ /* that command ended at the image end address without error.  */
+/***************************************************************/
+      if (!SessionStatus(Session, Status))
+         LogPrint(LOG_ERROR, "NO SUMCHECK FROM DEVICE\r\n");
+      else if (Status[STATUS_ERROR] || Status[STATUS_ADDRESS] != Image->End + 1)
+         LogPrint(LOG_ERROR, "SUMCHECK NOT VALID, LAST PASS ENDED AT: %6.6lX ERROR: %4.4lX\r\n", Status[STATUS_ADDRESS], Status[STATUS_ERROR]);
+      else if (!(Match = Status[STATUS_CHECKSUM] == CheckSum))
+         LogPrint(LOG_ERROR, "CHECKSUM MISMATCH, IMAGE: %8.8lX DEVICE: %8.8lX\r\n", CheckSum, Status[STATUS_CHECKSUM]);
+      if (Match)
+         LogPrint(LOG_INFO, "CHECKSUM MATCH: %8.8lX %6.6lX - %6.6lX\r\n", CheckSum, Image->Start, Image->End);
+      else
+      {
+         LogPrint(LOG_INFO, "\r\nVERIFY DATA\r\n");
+         LogPrint(LOG_INFO, "===========\r\n");
+         // Restore the full verify range used by the V operation, an
+         // unknown device keeps the image range.
+         if (DeviceSize(Session->DeviceCode)
+            && !SessionSetRange(Session, strtoul(argv[ARG_START_ADR], NULL, 16), DeviceSize(Session->DeviceCode) - 1))
+            return FALSE;
+         ProgressStart(&Progress, "VERIFY", Image->ByteCount, Session->Config.StatusFd);
+         SessionVerify(Session, argv[ARG_DATA_FILE], 0, ADDRESS_MAX, &Progress);
+         ProgressEnd(&Progress);
+      }
+   }
+  /*******************************************************/
+ /* Locate the differences between device and image.    */
+/*******************************************************/
+   else if (argv[ARG_OPERATION][0] == 'B')
+   {
+      LogPrint(LOG_INFO, "\r\nLOCATE DIFFERENCES\r\n");
+      LogPrint(LOG_INFO, "==================\r\n");
+      Locate(Session, Image);
+   }
+  /********************************************************/
+ /* Identify the device data from the known image index. */
+/********************************************************/
+   else if (argv[ARG_OPERATION][0] == 'I')
+   {
+      LogPrint(LOG_INFO, "\r\nIDENTIFY DEVICE\r\n");
+      LogPrint(LOG_INFO, "===============\r\n");
+      Identify(Session, Index);
+   }
+  /***********************************************************/
+ /* Find the fastest baud rate and record size of the link. */
+/***********************************************************/
+   else if (argv[ARG_OPERATION][0] == 'K')
+   {
+      LogPrint(LOG_INFO, "\r\nCALIBRATE LINK\r\n");
+      LogPrint(LOG_INFO, "==============\r\n");
+      Calibrate(Session, strtoul(argv[ARG_START_ADR], NULL, 16), strtoul(argv[ARG_END_ADR], NULL, 16));
+   }
+  /************************************************************/
+ /* Write the changes to a file to the device as it changes. */
+/************************************************************/
+   else if (argv[ARG_OPERATION][0] == 'M')
+   {
+      LogPrint(LOG_INFO, "\r\nWATCH FILE\r\n");
+      LogPrint(LOG_INFO, "==========\r\n");
+      Watch(Session, argv[ARG_DATA_FILE], strtoul(argv[ARG_START_ADR], NULL, 16));
+   }
+  /********************************************************************/
+ /* Read the device to a file in chunks, resuming an earlier read.   */
+/********************************************************************/
+   else if (argv[ARG_OPERATION][0] == 'F')
+   {
+      LogPrint(LOG_INFO, "\r\nREAD CHUNKS\r\n");
+      LogPrint(LOG_INFO, "===========\r\n");
+      ReadChunks(Session, argv[ARG_DATA_FILE], strtoul(argv[ARG_START_ADR], NULL, 16));
+   }
+  /**********************************************************/
+ /* Program devices one after another, until Ctrl-C.       */
+/**********************************************************/
+   else if (argv[ARG_OPERATION][0] == 'L')
+   {
+      LogPrint(LOG_INFO, "\r\nPRODUCTION LOOP\r\n");
+      LogPrint(LOG_INFO, "===============\r\n");
+      Loop(Session, argv[ARG_DATA_FILE], strtoul(argv[ARG_START_ADR], NULL, 16));
+   }
+   else
+      LogPrint(LOG_ERROR, "UNKNOWN OPERATION: %c\r\n", argv[ARG_OPERATION][0]);
+
+   return TRUE;
+}
+
+
+
+/*******************************************************************/
+/* Partial match of a known image, the number of device blocks     */
+/* found at the same address in the image, and at other addresses. */
+/*******************************************************************/
+typedef struct
+{
+   IndexEntryType* Entry;
+   unsigned long Same;
+   unsigned long Moved;
+   unsigned long Marker;
+} MatchType;
+
+
+static int MatchCompare(const void* Left, const void* Right)
+{
+   const MatchType* LeftMatch = Left;
+   const MatchType* RightMatch = Right;
+
+   if (LeftMatch->Same + LeftMatch->Moved != RightMatch->Same + RightMatch->Moved)
+      return (LeftMatch->Same + LeftMatch->Moved < RightMatch->Same + RightMatch->Moved) ? 1 : -1;
+
+   return (LeftMatch->Same < RightMatch->Same) - (LeftMatch->Same > RightMatch->Same);
+}
+
+
+
+/*************************************************************************/
+/* Identify the device data from the index of known images. The device   */
+/* is read from the start, 1 KB, then 4 KB, 16 KB and so on, while the   */
+/* hash of the data read still matches the start of a known image. The   */
+/* known images which match completely are reported as exact matches.    */
+/* Otherwise the rest of the device is read, and each block is looked up */
+/* in the index, reporting the known images sharing the most blocks.     */
+/* Returns FALSE if the device could not be read.                        */
+/*************************************************************************/
+short Identify(SessionType* Session, IndexType* Index)
+{
+   short Result = TRUE;
+   short Found = FALSE;
+   unsigned long Count;
+   unsigned long Block;
+   unsigned long Position;
+   unsigned long Alive = 0;
+   unsigned long Read = 0;
+   unsigned long End;
+   unsigned long Step = INDEX_BLOCK_SIZE;
+   unsigned long Size = DeviceSize(Session->DeviceCode);
+   IndexHashType Erased;
+   IndexHashType* Blocks;
+   IndexHashType* Chain;
+   IndexSlotType* Slot;
+   MatchType* Matches;
+   ImageType Image;
+   ProgressType Progress;
+   unsigned char Buffer[INDEX_BLOCK_SIZE];
+
+   if (!Size)
+   {
+      LogPrint(LOG_ERROR, "INVALID DEVICE SIZE\r\n");
+      return FALSE;
+   }
+   Blocks = malloc(Size / INDEX_BLOCK_SIZE * sizeof(IndexHashType));
+   Chain = malloc(Size / INDEX_BLOCK_SIZE * sizeof(IndexHashType));
+   Matches = calloc(Index->Count + 1, sizeof(MatchType));
+   if (!Blocks || !Chain || !Matches || !ImageCreate(&Image))
+   {
+      LogPrint(LOG_ERROR, "Failed to allocate memory for the image\r\n");
+      free(Blocks);
+      free(Chain);
+      free(Matches);
+      return FALSE;
+   }
+   for (Count = 0; Count < Index->Count; ++Count)
+      Matches[Count].Entry = &(Index->Entries[Count]);
+   memset(Buffer, IMAGE_ERASED, INDEX_BLOCK_SIZE);
+   Erased = IndexHash(Buffer, INDEX_BLOCK_SIZE);
+
+   ProgressStart(&Progress, "IDENTIFY", Size, Session->Config.StatusFd);
+   while (Read < Size)
+   {
+      End = (Size - Read < Step) ? Size : Read + Step;
+      if (!(Result = SessionReadImage(Session, &Image, Read, End - 1, &Progress)))
+         break;
+      for (Block = Read / INDEX_BLOCK_SIZE; Block < End / INDEX_BLOCK_SIZE; ++Block)
+      {
+         Blocks[Block] = IndexHash(&(Image.Data[Block * INDEX_BLOCK_SIZE]), INDEX_BLOCK_SIZE);
+         Chain[Block] = IndexChain(Block ? Chain[Block - 1] : INDEX_HASH_BASIS, Blocks[Block]);
+      }
+  /*************************************************************/
+ /* Known images starting with the first block of the device. */
+/*************************************************************/
+      if (!Read)
+         for (Position = 0; (Slot = IndexLookup(Index, Blocks[0], &Position));)
+            if (!Slot->Block && Slot->Entry->Size <= Size)
             {
-               fprintf(stderr, "\r\nVERIFY DATA\r\n");
-               fprintf(stderr, "===========\r\n");
-               SendData(FALSE, SerialPort, "V\r");
-               Result = ReceiveData(FALSE, SerialPort, Buffer, 1024, stderr);
-               if (!(File = fopen(argv[ARG_DATA_FILE], "rt")))
-                  fprintf(stderr, "Failed to open Motorola S-Record file: %s\r\n", argv[ARG_DATA_FILE]);
-               else
-               {
-                  Result = FALSE;
-                  Buffer[0] = '\0';
-                  while (!feof(File) && !Result)
-                  {
-                     Buffer[0] = '\0';
-                     fgets(Buffer, BUFF_SIZE, File);
-                     if (Buffer[0] == 'S')
-                     {
-                        SendData(FALSE, SerialPort, Buffer);
-                        Result = ReceiveData(FALSE, SerialPort, Buffer, 8, stderr);
-                        if (Buffer[0] != '\0')
-                           break;
-                     }
-                  };
-                  fclose(File);
-                  WaitForPrompt(SerialPort);
-               }
+               Matches[Slot->Entry - Index->Entries].Marker = TRUE;
+               ++Alive;
             }
-            else
-               fprintf(stderr, "UNKNOWN OPERATION: %s\r\n", argv[ARG_OPERATION][0]);
+      Read = End;
+      Step *= 4;
 
-  /*********************************************************/
- /* Display the EPP-2 status at the end of the operation. */
-/*********************************************************/
-            fprintf(stderr, "\r\nEEP-2 STATUS\n");
-            fprintf(stderr, "============\n");
-            SendData(FALSE, SerialPort, "G\r");
-            ReceiveData(FALSE, SerialPort, Buffer, 1024, stderr);
+  /*******************************************************************/
+ /* Compare the hash of the data read with the start of the images. */
+/*******************************************************************/
+      for (Count = 0; Count < Index->Count; ++Count)
+      {
+         if (!Matches[Count].Marker)
+            continue;
+         Block = (Matches[Count].Entry->BlockCount < Read / INDEX_BLOCK_SIZE) ? Matches[Count].Entry->BlockCount : Read / INDEX_BLOCK_SIZE;
+         if (Matches[Count].Entry->Chain[Block - 1] != Chain[Block - 1])
+         {
+            Matches[Count].Marker = FALSE;
+            --Alive;
          }
+         else if (Block == Matches[Count].Entry->BlockCount)
+         {
+            LogPrint(LOG_INFO, "\r\nEXACT MATCH: %s (%lu BYTES)\r\n", Matches[Count].Entry->Name, Matches[Count].Entry->Size);
+            Matches[Count].Marker = FALSE;
+            --Alive;
+            Found = TRUE;
+         }
+      }
+      if (!Alive && Found)
+         break;
+      // No known image matches the start, read the rest in one go.
+      if (!Alive)
+         Step = Size;
+   };
+   ProgressEnd(&Progress);
 
-EPP_2_ERROR:
-         close(SerialPort);
+  /*********************************************************************/
+ /* Count the blocks of the device found in each of the known images. */
+/*********************************************************************/
+   if (Result && !Found)
+   {
+      LogPrint(LOG_INFO, "\r\nDEVICE HASH: %16.16llX\r\n", Chain[Size / INDEX_BLOCK_SIZE - 1]);
+      for (Block = 0; Block < Size / INDEX_BLOCK_SIZE; ++Block)
+      {
+         if (Blocks[Block] == Erased)
+            continue;
+         for (Position = 0; (Slot = IndexLookup(Index, Blocks[Block], &Position));)
+         {
+            Count = Slot->Entry - Index->Entries;
+            if (Slot->Block == Block)
+            {
+               ++Matches[Count].Same;
+               // A block counted as moved is found at the same address too.
+               if (Matches[Count].Marker == Block + 1)
+                  --Matches[Count].Moved;
+               Matches[Count].Marker = Block + 1;
+            }
+            else if (Matches[Count].Marker != Block + 1)
+            {
+               ++Matches[Count].Moved;
+               Matches[Count].Marker = Block + 1;
+            }
+         }
       }
+      qsort(Matches, Index->Count, sizeof(MatchType), MatchCompare);
+      if (!Index->Count || !(Matches[0].Same + Matches[0].Moved))
+         LogPrint(LOG_INFO, "NO MATCH FOUND\r\n");
+      for (Count = 0; Count < Index->Count && Matches[Count].Same + Matches[Count].Moved; ++Count)
+         LogPrint(LOG_INFO, "PARTIAL MATCH: %3lu%% %lu/%lu BLOCKS SAME ADDRESS, %lu MOVED: %s\r\n",
+            Matches[Count].Same * 100 / Matches[Count].Entry->BlockCount, Matches[Count].Same,
+            Matches[Count].Entry->BlockCount, Matches[Count].Moved, Matches[Count].Entry->Name);
    }
+
+   ImageFree(&Image);
+   free(Blocks);
+   free(Chain);
+   free(Matches);
+
+   return Result;
 }
 
 
 
-/**********************************************************************/
-/* Wait for a command prompt to be available on the EPP-2 Programmer. */
-/**********************************************************************/
-void WaitForPrompt(int SerialPort)
+/*************************************************************************/
+/* Parse a list of address ranges, START-END,START-END,... or @FILE for  */
+/* the populated ranges of a Motorola S-Record file. Returns the number  */
+/* of ranges, zero if the text is a single address, or -1 if invalid.    */
+/*************************************************************************/
+short ParseRanges(char* Text, RangeType* Ranges, short MaxRanges)
 {
-   short Result = FALSE;
-   short TryCount = 200;
+   short Count = 0;
+   int Length;
+   ImageType Image;
+
+   if (Text[0] == '@')
+   {
+      if (!ImageCreate(&Image))
+         return -1;
+      if (!ImageLoadMotorola(&Image, &(Text[1]), 0) || !(Count = ImageRanges(&Image, Ranges, MaxRanges, IMAGE_RANGE_GAP)))
+         Count = -1;
+      ImageFree(&Image);
+      return Count;
+   }
+
+   if (!strchr(Text, '-'))
+      return 0;
+   while (*Text)
+   {
+      if (Count == MaxRanges || sscanf(Text, "%lX-%lX%n", &(Ranges[Count].Start), &(Ranges[Count].End), &Length) != 2
+         || Ranges[Count].End < Ranges[Count].Start)
+         return -1;
+      Text += Length;
+      ++Count;
+      if (*Text == ',')
+         ++Text;
+      else if (*Text)
+         return -1;
+   };
+
+   return Count;
+}
+
+
+
+/***************************************************************/
+/* Bytes of the device read or erased, from the start and end  */
+/* addresses or ranges. The device end is used if not given.   */
+/***************************************************************/
+unsigned long RangeTotal(int argc, char* argv[], int DeviceCode, RangeType* Ranges, short RangeCount)
+{
+   short RangeIndex;
+   unsigned long Total;
+
+   Total = DeviceSize(DeviceCode);
+   if (argc > ARG_END_ADR && !RangeCount)
+      Total = strtoul(argv[ARG_END_ADR], NULL, 16) + 1;
+   if (argc > ARG_START_ADR && !RangeCount && Total > strtoul(argv[ARG_START_ADR], NULL, 16))
+      Total -= strtoul(argv[ARG_START_ADR], NULL, 16);
+   for (RangeIndex = 0, Total = RangeCount ? 0 : Total; RangeIndex < RangeCount; ++RangeIndex)
+      Total += Ranges[RangeIndex].End - Ranges[RangeIndex].Start + 1;
+
+   return Total;
+}
+
+
+
+/*********************************************************************/
+/* Read the range already set to stdout, as one of several ranges.   */
+/* Each read of the EPP-2 is a whole file, so the header record is   */
+/* only kept for the First range, the termination record only for    */
+/* the Last range, and count records only when the range is both.    */
+/* Returns FALSE if the range could not be read.                     */
+/*********************************************************************/
+short RangeRead(SessionType* Session, short First, short Last, ProgressType* Progress)
+{
+   FILE* File;
+   short Result;
    char Buffer[BUFF_SIZE + 1];
+   char* Record;
 
-   SendData(TRUE, SerialPort, "\r");
-   sleep(1);
-   do
+   if (!(File = tmpfile()))
+      return FALSE;
+   if ((Result = SessionRead(Session, File, Progress)))
    {
-      Result = ReceiveData(TRUE, SerialPort, Buffer, 1024, stderr);
-   } while (Result != PROMPT && --TryCount);
-   sleep(1);
-   Result = ReceiveData(TRUE, SerialPort, Buffer, 1024, stderr);
-   if (!TryCount)
-      fprintf(stderr, "WARNING: DIDN'T FIND COMMAND PROMPT\r\n");
+      rewind(File);
+      while (fgets(Buffer, BUFF_SIZE, File))
+      {
+         Record = Buffer + strspn(Buffer, " \t\r\n");
+         if (Record[0] == 'S' && ((Record[1] == '0' && !First) || (strchr("789", Record[1]) && !Last)
+            || (strchr("56", Record[1]) && !(First && Last))))
+            continue;
+         fputs(Buffer, stdout);
+      }
+   }
+   fclose(File);
+
+   return Result;
 }
 
 
 
-/**************************************************************/
-/* Configure the local serial port on Linux for the specified */
-/* baud rate, provided as a string value.                     */
-/**************************************************************/
-void SelectBaudRate(struct termios* tty, unsigned char* BaudRate)
+/******************************************************************/
+/* Fill in the bytes and characters of an E, R, W or V operation  */
+/* and estimate its time. W and V send the Motorola file, V only  */
+/* the records inside the ranges.                                 */
+/******************************************************************/
+void EstimateOperation(EstimateType* Estimate, int argc, char* argv[], ImageType* Image, RangeType* Ranges, short RangeCount, ConfigType* Config)
+{
+   FILE* File;
+   short RangeIndex;
+   unsigned long Address;
+   unsigned long FileSize = 0;
+
+   memset(Estimate, 0, sizeof(EstimateType));
+   Estimate->Operation = argv[ARG_OPERATION][0];
+   sscanf(argv[ARG_DEVICE], "%X", &(Estimate->DeviceCode));
+   Estimate->BaudRate = atoi(Config->BaudRate);
+   if (strchr("ER", Estimate->Operation))
+      Estimate->Bytes = RangeTotal(argc, argv, Estimate->DeviceCode, Ranges, RangeCount);
+   else
+   {
+      if ((File = fopen(argv[ARG_DATA_FILE], "rb")))
+      {
+         fseek(File, 0, SEEK_END);
+         FileSize = ftell(File);
+         fclose(File);
+      }
+      Estimate->Bytes = Image->ByteCount;
+      Estimate->Characters = FileSize;
+      if (Estimate->Operation == 'V')
+      {
+         for (RangeIndex = 0, Estimate->Bytes = RangeCount ? 0 : Image->ByteCount; RangeIndex < RangeCount; ++RangeIndex)
+            Estimate->Bytes += ImageCount(Image, Ranges[RangeIndex].Start, Ranges[RangeIndex].End);
+         if (Image->ByteCount)
+            Estimate->Characters = (unsigned long)((double)FileSize * Estimate->Bytes / Image->ByteCount);
+      }
+      // Erased bytes are not programmed when the device code skips FF.
+      for (Address = Image->Start; Estimate->Operation == 'W' && Image->ByteCount && Address <= Image->End; ++Address)
+         if (Image->Used[Address] && (!(Estimate->DeviceCode & DEVICE_SKIP_FF) || Image->Data[Address] != 0xFF))
+            ++Estimate->ProgramBytes;
+   }
+
+   EstimateModel(Estimate);
+   EstimateCalibrate(Estimate, ESTIMATE_FILE);
+}
+
+
+
+/************************************************************************/
+/* Locate the locations where the device differs from the image. The    */
+/* range of the image is read from the device and each byte which       */
+/* differs is listed. Returns FALSE if the EPP-2 could not be read.     */
+/************************************************************************/
+short Locate(SessionType* Session, ImageType* Image)
 {
-  /******************************************************/
- /* Select a vaid baud rate for the Linux serial port. */
-/******************************************************/
-   if (!strcmp(BaudRate, "300"))
+   short Result;
+   unsigned long Address;
+   unsigned long Differences = 0;
+   ImageType Device;
+
+   if (!ImageCreate(&Device))
+   {
+      LogPrint(LOG_ERROR, "Failed to allocate memory for the image\r\n");
+      return FALSE;
+   }
+   if (!(Result = SessionReadImage(Session, &Device, Image->Start, Image->End, NULL)))
+      LogPrint(LOG_ERROR, "FAILED TO READ DEVICE: %6.6lX - %6.6lX\r\n", Image->Start, Image->End);
+   else
    {
-      cfsetispeed(tty, B300);
-      cfsetospeed(tty, B300);
+      LogPrint(LOG_INFO, "\r\n");
+      for (Address = Image->Start; Address <= Image->End; ++Address)
+         if (Device.Data[Address] != Image->Data[Address])
+         {
+            LogPrint(LOG_INFO, "%6.6lX IMAGE: %2.2X DEVICE: %2.2X\r\n", Address, Image->Data[Address], Device.Data[Address]);
+            ++Differences;
+         }
+      if (Differences)
+         LogPrint(LOG_INFO, "\r\n%lu BYTES DIFFER\r\n", Differences);
+      else
+         LogPrint(LOG_INFO, "NO DIFFERENCES FOUND\r\n");
    }
-   else if (!strcmp(BaudRate, "600"))
+   ImageFree(&Device);
+
+   return Result;
+}
+
+
+
+/*****************************************************/
+/* Time of a monotonic clock in seconds, for timing. */
+/*****************************************************/
+static double Seconds()
+{
+   struct timespec Now;
+
+   clock_gettime(CLOCK_MONOTONIC, &Now);
+
+   return Now.tv_sec + Now.tv_nsec / 1e9;
+}
+
+
+
+/*****************************************************************/
+/* Write a calibration S-Record file to the device, returning    */
+/* the seconds taken. The Result of the write is returned.       */
+/*****************************************************************/
+static double CalibrateWrite(SessionType* Session, char* FileName, short* Result)
+{
+   double Start;
+
+   Start = Seconds();
+   *Result = SessionWrite(Session, FileName, 0, ADDRESS_MAX, NULL);
+
+   return Seconds() - Start;
+}
+
+
+
+/**************************************************************************/
+/* Measure the write throughput of the link at each EPP-2 baud rate and   */
+/* each of the record sizes, by writing erased data, FF, to an empty      */
+/* scratch range of the device, which leaves the range empty. The fixed   */
+/* time of a write, measured by writing a file with no data records, is   */
+/* subtracted. Records sent again after a communication error count       */
+/* against a setting. The fastest setting is written to the profile of    */
+/* the serial port, and used for the rest of the session.                 */
+/* Returns FALSE if the range is not empty or no setting worked.          */
+/**************************************************************************/
+short Calibrate(SessionType* Session, unsigned long Start, unsigned long End)
+{
+   static short RecordSizes[CALIBRATE_SIZES] = { 16, 32, 64, IMAGE_MAX_RECORD };
+   FILE* File;
+   short Result;
+   short Count;
+   short Rate;
+   short BestRate = -1;
+   short BestSize = 0;
+   int Descriptor;
+   long FileSize = 0;
+   long FileSizes[CALIBRATE_SIZES + 1];
+   double Overhead;
+   double Time;
+   double Throughput;
+   double BestThroughput = 0;
+   unsigned char Silent;
+   unsigned char BaudRate[BUFF_SIZE + 1];
+   char FileNames[CALIBRATE_SIZES + 1][BUFF_SIZE + 1];
+   ImageType Image;
+   ImageType Empty;
+
+   if (!SessionSetOffset(Session, 0) || !SessionSetRange(Session, Start, End) || !SessionEmpty(Session))
    {
-      cfsetispeed(tty, B600);
-      cfsetospeed(tty, B600);
+      LogPrint(LOG_ERROR, "CALIBRATION RANGE IS NOT EMPTY: %6.6lX - %6.6lX\r\n", Start, End);
+      return FALSE;
    }
-   else if (!strcmp(BaudRate, "1200"))
+   if (!ImageCreate(&Image))
    {
-      cfsetispeed(tty, B1200);
-      cfsetospeed(tty, B1200);
+      LogPrint(LOG_ERROR, "Failed to allocate memory for the image\r\n");
+      return FALSE;
    }
-   else if (!strcmp(BaudRate, "2400"))
+
+  /******************************************************************/
+ /* A file of each record size, then a file with no data records.  */
+/******************************************************************/
+   ImageFill(&Image, Start, End, IMAGE_ERASED);
+   // Only the byte count of an image with no data is used.
+   memset(&Empty, 0, sizeof(ImageType));
+   for (Count = 0, Result = TRUE; Count <= CALIBRATE_SIZES; ++Count)
    {
-      cfsetispeed(tty, B2400);
-      cfsetospeed(tty, B2400);
+      strcpy(FileNames[Count], "/tmp/EPP-2_CAL.XXXXXX");
+      if (Result && (Result = ((Descriptor = mkstemp(FileNames[Count])) >= 0)))
+      {
+         close(Descriptor);
+         Result = ImageWriteMotorola((Count < CALIBRATE_SIZES) ? &Image : &Empty, FileNames[Count], (Count < CALIBRATE_SIZES) ? RecordSizes[Count] : 1);
+      }
+      if (Result && (File = fopen(FileNames[Count], "rb")))
+      {
+         fseek(File, 0, SEEK_END);
+         FileSizes[Count] = ftell(File);
+         FileSize += FileSizes[Count];
+         fclose(File);
+      }
    }
-   else if (!strcmp(BaudRate, "4800"))
+   ImageFree(&Image);
+
+  /****************************************************************/
+ /* Time each record size at each baud rate, fastest rate first. */
+/****************************************************************/
+   strcpy(BaudRate, Session->Config.BaudRate);
+   Silent = Session->Silent;
+   LogPrint(LOG_INFO, "%lu BYTES, RECORD SIZES %d - %d\r\n", End - Start + 1, RecordSizes[0], RecordSizes[CALIBRATE_SIZES - 1]);
+   for (Rate = 0; Result && SessionBaudRate(Rate); ++Rate)
    {
-      cfsetispeed(tty, B4800);
-      cfsetospeed(tty, B4800);
+      // Each bit of a character is sent in 1/BAUD seconds, 10 bits per character.
+      if (FileSize * 10.0 / atoi(SessionBaudRate(Rate)) > CALIBRATE_MAX_TIME)
+      {
+         LogPrint(LOG_INFO, "%6s BAUD SKIPPED, OVER %d SECONDS\r\n", SessionBaudRate(Rate), CALIBRATE_MAX_TIME);
+         continue;
+      }
+      Session->Silent = TRUE;
+      if (!SessionSetBaud(Session, SessionBaudRate(Rate)))
+      {
+         Session->Silent = Silent;
+         LogPrint(LOG_INFO, "%6s BAUD NO RESPONSE\r\n", SessionBaudRate(Rate));
+         strcpy(Session->Config.BaudRate, BaudRate);
+         if (!(Result = SessionHandshake(Session)))
+            break;
+         continue;
+      }
+      Overhead = CalibrateWrite(Session, FileNames[CALIBRATE_SIZES], &Result);
+      for (Count = 0; Result && Count < CALIBRATE_SIZES; ++Count)
+      {
+         Session->RetryCount = 0;
+         Time = CalibrateWrite(Session, FileNames[Count], &Result) - Overhead;
+         // Timing jitter aside, no file is sent faster than the baud rate.
+         if (Time < FileSizes[Count] * 10.0 / atoi(SessionBaudRate(Rate)))
+            Time = FileSizes[Count] * 10.0 / atoi(SessionBaudRate(Rate));
+         Throughput = (End - Start + 1) / Time;
+         Session->Silent = Silent;
+         LogPrint(LOG_INFO, "%6s BAUD %4d BYTE RECORDS %7.0f B/s %lu RETRIES%s\r\n", SessionBaudRate(Rate), RecordSizes[Count],
+            Throughput, Session->RetryCount, Result ? "" : " FAILED");
+         Session->Silent = TRUE;
+         // An error costs at least a resend of the batch and a status query.
+         Throughput /= 1 + Session->RetryCount;
+         if (Result && Throughput > BestThroughput)
+         {
+            BestThroughput = Throughput;
+            BestRate = Rate;
+            BestSize = RecordSizes[Count];
+         }
+      }
+      Session->Silent = Silent;
+      // A failure at one rate still leaves the other rates to try.
+      Result = TRUE;
    }
-   else if (!strcmp(BaudRate, "9600"))
+   for (Count = 0; Count <= CALIBRATE_SIZES; ++Count)
+      remove(FileNames[Count]);
+
+  /****************************************************************/
+ /* Keep the fastest setting, in the profile of the serial port. */
+/****************************************************************/
+   if (BestRate < 0)
    {
-      cfsetispeed(tty, B9600);
-      cfsetospeed(tty, B9600);
+      LogPrint(LOG_ERROR, "NO WORKING SETTING FOUND\r\n");
+      strcpy(Session->Config.BaudRate, BaudRate);
+      SessionHandshake(Session);
+      return FALSE;
    }
-   else if (!strcmp(BaudRate, "19200"))
+   LogPrint(LOG_INFO, "\r\nBEST: %s BAUD, %d BYTE RECORDS, %.0f B/s\r\n", SessionBaudRate(BestRate), BestSize, BestThroughput);
+   if (strcmp(Session->Config.BaudRate, SessionBaudRate(BestRate)) && !SessionSetBaud(Session, SessionBaudRate(BestRate)))
    {
-      cfsetispeed(tty, B19200);
-      cfsetospeed(tty, B19200);
+      strcpy(Session->Config.BaudRate, BaudRate);
+      SessionHandshake(Session);
    }
+   Session->Config.RecordSize = BestSize;
+   if (ConfigWriteProfile(&(Session->Config)))
+      LogPrint(LOG_INFO, "PROFILE WRITTEN FOR %s, USE ./BinToMotorola [START_ADR] [MAX_ADR] [BIN_FILE] %d\r\n", Session->Config.SerialPort, BestSize);
+
+   return TRUE;
+}
+
+
+
+/***********************************************************/
+/* Set by Ctrl-C, to end the M operation between changes.  */
+/***********************************************************/
+static volatile sig_atomic_t WatchStop = FALSE;
+
+static void WatchSignal(int Signal)
+{
+   WatchStop = TRUE;
+}
+
+
+
+/**********************************************************/
+/* Watch the directory of a file for the file to change.  */
+/**********************************************************/
+static void WatchAdd(int Notify, char* FileName)
+{
+   char* Slash;
+   char Directory[BUFF_SIZE + 1];
+
+   strncpy(Directory, FileName, BUFF_SIZE);
+   Directory[BUFF_SIZE] = '\0';
+   if (!(Slash = strrchr(Directory, '/')))
+      strcpy(Directory, ".");
+   else if (Slash == Directory)
+      strcpy(Directory, "/");
+   else
+      *Slash = '\0';
+   inotify_add_watch(Notify, Directory, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+}
+
+
+
+/********************************************************************/
+/* Load the watched file into a new image, a manifest of binary     */
+/* files if the name ends .MAN, otherwise a Motorola S record,      */
+/* Intel HEX or binary file. The directories of the files of a      */
+/* manifest are watched too. Returns FALSE if the file is invalid   */
+/* or has no data, as while it is being written.                    */
+/********************************************************************/
+static short WatchLoad(ImageType* Image, char* FileName, unsigned long Offset, int Notify)
+{
+   short Result;
+   short Count;
+   ManifestType Manifest;
+
+   if (!ImageCreate(Image))
+      return FALSE;
+   Manifest.Count = 0;
+   if (strlen(FileName) > 4 && !strcasecmp(&(FileName[strlen(FileName) - 4]), ".MAN"))
+      Result = ImageReadManifest(&Manifest, FileName) && ImageLoadManifest(Image, &Manifest);
    else
+      Result = ImageLoadFile(Image, FileName, Offset);
+   for (Count = 0; Count < Manifest.Count; ++Count)
+      WatchAdd(Notify, Manifest.Assets[Count].FileName);
+   if (Manifest.Count)
+      ImageFreeManifest(&Manifest);
+   if (!Result || !Image->ByteCount)
    {
-      cfsetispeed(tty, B9600);
-      cfsetospeed(tty, B9600);
-      fprintf(stderr, "INVALID BAUD RATE FOR EPP-2 PROGRAMMER: %s\r\n", BaudRate);
+      ImageFree(Image);
+      return FALSE;
    }
+
+   return TRUE;
 }
 
 
 
-unsigned char* ChrReplace(unsigned char* Data, unsigned char Find, unsigned char Replace)
+/**********************************************************************/
+/* Wait for a change in the watched directories, then for the files   */
+/* to settle, no change for WATCH_SETTLE_TIME ms. Returns FALSE if    */
+/* the wait ended with Ctrl-C.                                        */
+/**********************************************************************/
+static short WatchWait(int Notify)
 {
-   unsigned short Count;
-   
-   for (Count = 0; Count < strlen(Data); ++Count)
-      if (Data[Count] == Find)
-         Data[Count] = Replace;
+   short Changed = FALSE;
+   struct pollfd Poll;
+   char Events[WATCH_EVENT_SIZE];
 
-   return Data;
+   Poll.fd = Notify;
+   Poll.events = POLLIN;
+   while (!WatchStop)
+   {
+      if (poll(&Poll, 1, Changed ? WATCH_SETTLE_TIME : -1) == 0)
+         return TRUE;
+      // Drain the events, any event restarts the settle time.
+      while (read(Notify, Events, WATCH_EVENT_SIZE) > 0)
+         Changed = TRUE;
+   };
+
+   return FALSE;
 }
 
 
 
-/***********************************************************/
-/* Send data to the EPP-2 Programmer, via the serial port. */
-/***********************************************************/
-void SendData(unsigned char Silent, int SerialPort, char* Data)
+/**************************************************************************/
+/* Keep a device up to date with a file while it is being developed. The  */
+/* device is read over the range of the file, then each time the file,    */
+/* or a file of a manifest, changes and settles, the file is converted    */
+/* in memory and only the records which differ from the device are        */
+/* written, intended for EEPROM devices. Ends with Ctrl-C.                */
+/* Returns FALSE if the file could not be loaded or the device read.      */
+/**************************************************************************/
+short Watch(SessionType* Session, char* FileName, unsigned long Offset)
 {
-   write(SerialPort, Data, strlen(Data));
-   if (!Silent)
-      fprintf(stderr, ">%s\n", ChrReplace(Data, 0x1B, '~'));
+   short Result = TRUE;
+   int Notify;
+   int Descriptor = -1;
+   long Bytes;
+   char ChangeFile[BUFF_SIZE + 1];
+   ImageType Image;
+   ImageType Device;
+   ImageType Next;
+   ProgressType Progress;
+   void (*Interrupt)(int);
+
+   if (!DeviceSize(Session->DeviceCode))
+   {
+      LogPrint(LOG_ERROR, "DEVICE SIZE NOT KNOWN: %6.6X\r\n", Session->DeviceCode);
+      return FALSE;
+   }
+   if ((Notify = inotify_init1(IN_NONBLOCK)) < 0)
+   {
+      LogPrint(LOG_ERROR, "FAILED TO WATCH FILE: %s\r\n", FileName);
+      return FALSE;
+   }
+   WatchAdd(Notify, FileName);
+   if (!WatchLoad(&Image, FileName, Offset, Notify))
+   {
+      LogPrint(LOG_ERROR, "NO DATA IN FILE: %s\r\n", FileName);
+      close(Notify);
+      return FALSE;
+   }
+   strcpy(ChangeFile, "/tmp/EPP-2_WATCH.XXXXXX");
+   if (ImageCreate(&Device) && (Descriptor = mkstemp(ChangeFile)) >= 0)
+      close(Descriptor);
+  /***************************************************************/
+ /* Records are written at the device addresses, with Offset 0. */
+/***************************************************************/
+   if (Descriptor < 0 || !SessionSetOffset(Session, 0)
+      || !SessionReadImage(Session, &Device, Image.Start, Image.End, NULL)
+      || !SessionSetRange(Session, 0, DeviceSize(Session->DeviceCode) - 1))
+   {
+      LogPrint(LOG_ERROR, "FAILED TO READ DEVICE: %6.6lX - %6.6lX\r\n", Image.Start, Image.End);
+      ImageFree(&Image);
+      ImageFree(&Device);
+      close(Notify);
+      if (Descriptor >= 0)
+         remove(ChangeFile);
+      return FALSE;
+   }
+
+   // The handler replaced, which restores the serial port, is put back after.
+   Interrupt = signal(SIGINT, WatchSignal);
+   LogPrint(LOG_INFO, "\r\nWATCHING: %s, CTRL-C TO END\r\n", FileName);
+   while (!WatchStop)
+   {
+  /***********************************************************/
+ /* Write the records which differ from the device, if any. */
+/***********************************************************/
+      if ((Bytes = ImageWriteChanges(&Image, &Device, ChangeFile, Session->Config.RecordSize)) > 0)
+      {
+         ProgressStart(&Progress, "WRITE", Bytes, Session->Config.StatusFd);
+         Result = SessionWrite(Session, ChangeFile, 0, ADDRESS_MAX, &Progress);
+         ProgressEnd(&Progress);
+         LogPrint(Result ? LOG_INFO : LOG_ERROR, "%s %ld BYTES CHANGED: %s\r\n", Result ? "PROGRAMMED" : "FAILED TO PROGRAM", Bytes, FileName);
+         // The device now holds the image, the image is loaded again on the next change.
+         if (Result)
+         {
+            ImageFree(&Device);
+            Device = Image;
+            Image.Data = NULL;
+            Image.Used = NULL;
+         }
+      }
+      else if (!Bytes)
+         LogPrint(LOG_INFO, "NO CHANGES: %s\r\n", FileName);
+
+  /*********************************************************************/
+ /* Wait for the next change, an invalid file is loaded at the next.  */
+/*********************************************************************/
+      while (WatchWait(Notify) && !WatchLoad(&Next, FileName, Offset, Notify))
+         LogPrint(LOG_INFO, "WAITING FOR VALID DATA: %s\r\n", FileName);
+      if (WatchStop)
+         break;
+      ImageFree(&Image);
+      Image = Next;
+   };
+   signal(SIGINT, Interrupt);
+
+   ImageFree(&Image);
+   ImageFree(&Device);
+   close(Notify);
+   remove(ChangeFile);
+
+   return TRUE;
 }
 
 
 
-/****************************************************************/
-/* Receive data from the EPP-2 Programmer, via the serial port. */
-/****************************************************************/
-short ReceiveData(unsigned char Silent, int SerialPort, char* Data, int TimeOut, FILE* OutStream)
+/******************************************************************/
+/* Check the chunks of an interrupted F operation already in the  */
+/* file against the sumchecks of its journal. The file is cut to  */
+/* the last chunk which matches, as is the journal, and the       */
+/* address of the next chunk returned, Start if the journal is    */
+/* missing or does not match the device and range being read.     */
+/******************************************************************/
+static unsigned long ChunkResume(char* FileName, char* JournalFile, char* Header, unsigned long Start)
 {
-   short Result = FALSE;
-   unsigned char FirstLine = TRUE;
-   unsigned int ByteCount = 0;
-   int TimeOutCount;
-   int Bytes;
+   FILE* Journal;
+   long Length = 0;
+   long Last = 0;
+   long Committed;
+   long Kept;
+   unsigned long Next = Start;
+   unsigned long ChunkStart;
+   unsigned long ChunkEnd;
+   unsigned long CheckSum;
+   unsigned long Bytes;
    char Buffer[BUFF_SIZE + 1];
-   struct timespec Sleep = { 0, 1000000};
-   
-   Data[0] = '\0';
-   TimeOutCount = 0;
-   do
+   ImageType Image;
+
+   if (!(Journal = fopen(JournalFile, "rt")))
+      return Start;
+   if (!fgets(Buffer, BUFF_SIZE, Journal) || strcmp(Buffer, Header))
+   {
+      LogPrint(LOG_INFO, "JOURNAL IS OF ANOTHER READ, READING FROM THE START: %s\r\n", JournalFile);
+      fclose(Journal);
+      return Start;
+   }
+   Committed = ftell(Journal);
+   while (fgets(Buffer, BUFF_SIZE, Journal))
+      if (sscanf(Buffer, "CHUNK %lX %lX %lX %lu %ld", &ChunkStart, &ChunkEnd, &CheckSum, &Bytes, &Length) == 5)
+         Last = Length;
+
+    /*********************************************************************/
+   /* Drop any part of a chunk written after the last commit, then load */
+  /* the file and keep each chunk while its bytes and sumcheck match,  */
+ /* a damaged record ends the load, and so the chunks kept.           */
+/*********************************************************************/
+   if (!Last || truncate(FileName, Last) || !ImageCreate(&Image))
+   {
+      fclose(Journal);
+      return Start;
+   }
+   ImageLoadMotorola(&Image, FileName, 0);
+   fseek(Journal, Committed, SEEK_SET);
+   Length = 0;
+   Kept = Committed;
+   while (fgets(Buffer, BUFF_SIZE, Journal)
+      && sscanf(Buffer, "CHUNK %lX %lX %lX %lu %ld", &ChunkStart, &ChunkEnd, &CheckSum, &Bytes, &Last) == 5
+      && ChunkStart == Next && ImageCount(&Image, ChunkStart, ChunkEnd) == Bytes
+      && ImageCheckSum(&Image, ChunkStart, ChunkEnd) == CheckSum)
+   {
+      Next = ChunkEnd + 1;
+      Length = Last;
+      Kept = ftell(Journal);
+   }
+   if (Next > Start && (truncate(FileName, Length) || truncate(JournalFile, Kept)))
+      Next = Start;
+   ImageFree(&Image);
+   fclose(Journal);
+
+   return Next;
+}
+
+
+
+/*************************************************************************/
+/* Read the device from Start to its end into a Motorola S record file,  */
+/* one chunk of READ_CHUNK bytes at a time, each with its own P and L    */
+/* range. With READ_VERIFY the data of each chunk is checked against the */
+/* EPP-2 sumcheck of the range, and read again if it differs. The chunk  */
+/* is then written and flushed to the file, and committed to a journal   */
+/* with its sumcheck, bytes and the length of the file. A read broken    */
+/* off is resumed after the last committed chunk found in the file. The  */
+/* journal is removed once the device is read. Returns FALSE if a chunk  */
+/* could not be read.                                                    */
+/*************************************************************************/
+short ReadChunks(SessionType* Session, char* FileName, unsigned long Start)
+{
+   FILE* File;
+   FILE* Journal;
+   short Result = TRUE;
+   short Retry;
+   short Length;
+   unsigned long End;
+   unsigned long Next;
+   unsigned long Address;
+   unsigned long ChunkEnd;
+   unsigned long CheckSum = 0;
+   unsigned long Bytes;
+   unsigned long Status[STATUS_COUNT];
+   char JournalFile[2 * BUFF_SIZE + 1];
+   char Header[BUFF_SIZE + 1];
+   ImageType Image;
+   ProgressType Progress;
+
+   if (!DeviceSize(Session->DeviceCode) || Start >= DeviceSize(Session->DeviceCode))
+   {
+      LogPrint(LOG_ERROR, "START ADDRESS OUTSIDE DEVICE: %6.6lX\r\n", Start);
+      return FALSE;
+   }
+   End = DeviceSize(Session->DeviceCode) - 1;
+   snprintf(JournalFile, 2 * BUFF_SIZE, CHUNK_JOURNAL, FileName);
+   sprintf(Header, "EPP-2_PROG F %6.6X %6.6lX %6.6lX %lX\n", Session->DeviceCode, Start, End, Session->Config.ReadChunk);
+   Next = ChunkResume(FileName, JournalFile, Header, Start);
+   if (Next > End)
+      LogPrint(LOG_INFO, "ALL CHUNKS ALREADY READ: %s\r\n", FileName);
+   else if (Next > Start)
+      LogPrint(LOG_INFO, "RESUMING AFTER %lu BYTES: %6.6lX - %6.6lX\r\n", Next - Start, Next, End);
+
+  /*********************************************************************/
+ /* Continue the file and journal of a resumed read, or start both.   */
+/*********************************************************************/
+   File = fopen(FileName, (Next > Start) ? "ab" : "wb");
+   Journal = fopen(JournalFile, (Next > Start) ? "at" : "wt");
+   if (!File || !Journal || !ImageCreate(&Image))
+   {
+      LogPrint(LOG_ERROR, "Failed to open file for writing: %s\r\n", (!File) ? FileName : JournalFile);
+      if (File)
+         fclose(File);
+      if (Journal)
+         fclose(Journal);
+      return FALSE;
+   }
+   if (Next == Start)
+      fputs(Header, Journal);
+
+  /****************************************************************/
+ /* Records are read at the device addresses, with Offset 0.     */
+/****************************************************************/
+   Address = Next;
+   Result = SessionSetOffset(Session, 0);
+   ProgressStart(&Progress, "READ", End + 1 - Next, Session->Config.StatusFd);
+   for (; Result && Address <= End; Address = ChunkEnd + 1)
    {
-      if ((Bytes = read(SerialPort, Buffer, BUFF_SIZE)))
+      ChunkEnd = (End - Address < Session->Config.ReadChunk) ? End : Address + Session->Config.ReadChunk - 1;
+      for (Retry = 0; Retry <= CHUNK_RETRIES; ++Retry)
       {
-         TimeOutCount = 0;
-         ByteCount += Bytes;
-         Buffer[Bytes] = '\0';
-         if (Buffer[Bytes - 1] == '*')
+         Result = SessionReadImage(Session, &Image, Address, ChunkEnd, &Progress);
+         CheckSum = ImageCheckSum(&Image, Address, ChunkEnd);
+         if (!Result)
+            LogPrint(LOG_ERROR, "CHUNK READ FAILED: %6.6lX - %6.6lX\r\n", Address, ChunkEnd);
+         else if (Session->Config.ReadVerify && !SessionStatus(Session, Status))
          {
-            Result = PROMPT;
-            break;
+            Result = FALSE;
+            LogPrint(LOG_ERROR, "NO SUMCHECK RECEIVED FOR CHUNK: %6.6lX - %6.6lX\r\n", Address, ChunkEnd);
+         }
+         else if (Session->Config.ReadVerify && (Status[STATUS_ERROR] || Status[STATUS_ADDRESS] != ChunkEnd + 1))
+         {
+            Result = FALSE;
+            LogPrint(LOG_ERROR, "CHUNK READ ENDED AT: %6.6lX ERROR: %4.4lX %6.6lX - %6.6lX\r\n",
+               Status[STATUS_ADDRESS], Status[STATUS_ERROR], Address, ChunkEnd);
          }
-         if (strcmp(Buffer, "Error\n"))
-            Result = TRUE;
-         if (FirstLine && strchr(Buffer, '\r'))
+         else if (Session->Config.ReadVerify && Status[STATUS_CHECKSUM] != CheckSum)
          {
-            FirstLine = FALSE;
-            strcpy(Data, &(strchr(Buffer, '\r')[1]));
+            Result = FALSE;
+            LogPrint(LOG_ERROR, "CHUNK SUMCHECK MISMATCH, READ: %8.8lX DEVICE: %8.8lX %6.6lX - %6.6lX\r\n",
+               CheckSum, Status[STATUS_CHECKSUM], Address, ChunkEnd);
          }
          else
-            strcpy(Data, Buffer);
-         if (OutStream == stdout)
+            break;
+      }
+      if (!Result)
+         break;
+
+  /************************************************************/
+ /* Write the chunk, then commit it once it is on the disk.  */
+/************************************************************/
+      for (Next = Address, Bytes = 0; Next <= ChunkEnd; Next += Length)
+      {
+         for (Length = 0; Length < IMAGE_RECORD_SIZE && Next + Length <= ChunkEnd && Image.Used[Next + Length]; ++Length);
+         if (!Length)
+            Length = 1;
+         else
          {
-            if (!Silent)
-               fprintf(stderr, "%u Bytes Received\r", ByteCount);
-            fprintf(OutStream, Data);
+            ImageMotorolaRecord(File, Next, &(Image.Data[Next]), Length);
+            Bytes += Length;
          }
-         else if (!Silent)
-            fprintf(OutStream, ChrReplace(Data, 0x1B, '~'));
       }
-      if (TimeOut)
-         nanosleep(&Sleep, NULL);
-   } while (++TimeOutCount < TimeOut);
-   if (!Silent && ByteCount)
-      fprintf(OutStream, "\n");
+      fflush(File);
+      fsync(fileno(File));
+      fprintf(Journal, "CHUNK %6.6lX %6.6lX %8.8lX %lu %ld\n", Address, ChunkEnd, CheckSum, Bytes, ftell(File));
+      fflush(Journal);
+      fsync(fileno(Journal));
+      LogPrint(LOG_INFO, "\r\nCHUNK COMMITTED: %6.6lX - %6.6lX SUMCHECK %8.8lX\r\n", Address, ChunkEnd, CheckSum);
+   }
+   ProgressEnd(&Progress);
+
+   if (Result)
+      ImageMotorolaEnd(File, 0);
+   if (fclose(File))
+      Result = FALSE;
+   fclose(Journal);
+   ImageFree(&Image);
+   if (Result)
+   {
+      remove(JournalFile);
+      LogPrint(LOG_INFO, "\r\nDEVICE READ: %6.6lX - %6.6lX TO %s\r\n", Start, End, FileName);
+   }
+   else
+      LogPrint(LOG_ERROR, "\r\nREAD STOPPED AT %6.6lX, RUN AGAIN TO RESUME: %s\r\n", Address, FileName);
+
+   // Restore the whole range read, for the final sumcheck.
+   SessionSetRange(Session, Start, End);
+
+   return Result;
+}
+
+
+
+/************************************************************/
+/* Set by Ctrl-C, to end the L operation after the device   */
+/* being programmed.                                        */
+/************************************************************/
+static volatile sig_atomic_t LoopStop = FALSE;
+
+static void LoopSignal(int Signal)
+{
+   LoopStop = TRUE;
+}
+
+
+
+/*******************************************************************/
+/* File programmed by the L operation, as a copy in device address */
+/* records so the file can be replaced while a device is written.  */
+/*******************************************************************/
+typedef struct
+{
+   char* FileName;
+   unsigned long Offset;
+   unsigned long Size;
+   short RecordSize;
+   // Time and length of the file when it was copied.
+   struct timespec Modified;
+   off_t Length;
+   char Copy[BUFF_SIZE + 1];
+   unsigned long Start;
+   unsigned long End;
+   unsigned long Bytes;
+   // Whether the file was copied again, and whether it was valid.
+   short Changed;
+   short Result;
+} LoopImageType;
+
+
+
+/*****************************************************************/
+/* Check, load and copy the file of the L operation if it has    */
+/* changed since it was last copied. Run as a thread while a     */
+/* device is programmed, so the next device need not wait.       */
+/*****************************************************************/
+static void* LoopPrepare(void* Context)
+{
+   int Descriptor;
+   struct stat Info;
+   ImageType Image;
+   LoopImageType* Prepared = (LoopImageType*)Context;
+
+   Prepared->Changed = FALSE;
+   Prepared->Result = !stat(Prepared->FileName, &Info);
+   if (Prepared->Result && Info.st_mtim.tv_sec == Prepared->Modified.tv_sec
+      && Info.st_mtim.tv_nsec == Prepared->Modified.tv_nsec && Info.st_size == Prepared->Length)
+      return NULL;
+
+   Prepared->Changed = TRUE;
+   Prepared->Modified = Info.st_mtim;
+   Prepared->Length = Info.st_size;
+   strcpy(Prepared->Copy, LOOP_FILE);
+   Image.Data = NULL;
+   Image.Used = NULL;
+   Prepared->Result = Prepared->Result && PreflightMotorola(Prepared->FileName, Prepared->Offset, Prepared->Size)
+      && ImageCreate(&Image) && ImageLoadMotorola(&Image, Prepared->FileName, Prepared->Offset) && Image.ByteCount;
+   if (Prepared->Result)
+   {
+      Prepared->Start = Image.Start;
+      Prepared->End = Image.End;
+      Prepared->Bytes = Image.ByteCount;
+      if ((Descriptor = mkstemp(Prepared->Copy)) < 0)
+         Prepared->Result = FALSE;
+      else
+      {
+         close(Descriptor);
+         if (!(Prepared->Result = ImageWriteMotorola(&Image, Prepared->Copy, Prepared->RecordSize)))
+            remove(Prepared->Copy);
+      }
+   }
+   ImageFree(&Image);
+
+   return NULL;
+}
+
+
+
+/*****************************************************************/
+/* Use the file prepared for the next device, if it was changed. */
+/* Returns FALSE if the changed file is not valid.               */
+/*****************************************************************/
+static short LoopTake(LoopImageType* Current, LoopImageType* Next)
+{
+   if (!Next->Result)
+   {
+      LogPrint(LOG_ERROR, "FILE CHECK FAILED, NO MORE DEVICES PROGRAMMED: %s\r\n", Next->FileName);
+      return FALSE;
+   }
+   if (Next->Changed)
+   {
+      remove(Current->Copy);
+      *Current = *Next;
+      LogPrint(LOG_INFO, "\r\nFILE LOADED: %s %lu BYTES %6.6lX - %6.6lX\r\n", Current->FileName, Current->Bytes, Current->Start, Current->End);
+   }
+
+   return TRUE;
+}
+
+
+
+/***********************************************************************/
+/* Read a small range of the device in the socket, silently, giving    */
+/* the EPP-2 error code and sumcheck of the range read, and whether    */
+/* the range is blank. The data read is discarded, the sumcheck of the */
+/* R command stands for the whole range. Returns FALSE if the EPP-2    */
+/* did not reply or the read did not reach the end of the range.       */
+/***********************************************************************/
+static short LoopProbe(SessionType* Session, LoopImageType* Current, unsigned long* Probe)
+{
+   short Result;
+   unsigned char Silent;
+   unsigned long End;
+   unsigned long Status[STATUS_COUNT];
+
+   End = (Current->Size - Current->Start > Session->Config.LoopProbe) ? Current->Start + Session->Config.LoopProbe - 1 : Current->Size - 1;
+   Silent = Session->Silent;
+   Session->Silent = TRUE;
+   Result = SessionSetRange(Session, Current->Start, End) && SessionSetOffset(Session, 0);
+   if (Result)
+   {
+      SendData(Session, TRUE, "R\r");
+      WaitForPrompt(Session);
+      Result = SessionStatus(Session, Status) && Status[STATUS_ADDRESS] == End + 1;
+   }
+   Session->Silent = Silent;
+   if (Result)
+   {
+      Probe[0] = Status[STATUS_ERROR];
+      Probe[1] = Status[STATUS_CHECKSUM];
+      Probe[2] = !Probe[0] && Probe[1] == ((End - Current->Start + 1) * 0xFF & 0xFFFFFFFF);
+   }
+
+   return Result;
+}
+
+
+
+/*********************************************************************/
+/* Wait for the next device, either Enter from the operator or the   */
+/* device being taken out and a blank device put in. Taken out is    */
+/* the probe differing from the device just programmed, put in is a  */
+/* blank probe after that, each unchanged for LOOP_SETTLE ms. If the */
+/* empty socket reads as blank Probing is cleared, only Enter is     */
+/* used from then on. Returns FALSE on Ctrl-C, when the EPP-2 stops  */
+/* replying, or at the end of stdin with no probe.                   */
+/*********************************************************************/
+static short LoopWait(SessionType* Session, LoopImageType* Current, unsigned long* Last, short* Console, short* Probing)
+{
+   short Removed = FALSE;
+   double Changed;
+   char Buffer[BUFF_SIZE + 1];
+   unsigned long Probe[3];
+   unsigned long Previous[2];
+   struct pollfd Poll;
+
+   Previous[0] = Last[0];
+   Previous[1] = Last[1];
+   Changed = ProgressTime();
+   Poll.fd = STDIN_FILENO;
+   Poll.events = POLLIN;
+   while (!LoopStop && (*Console || *Probing))
+   {
+      Poll.revents = 0;
+      if (poll(&Poll, *Console ? 1 : 0, LOOP_POLL_TIME) > 0 && (Poll.revents & (POLLIN | POLLHUP)))
+      {
+         if (read(STDIN_FILENO, Buffer, BUFF_SIZE) > 0)
+            return TRUE;
+         *Console = FALSE;
+      }
+      else if (*Probing)
+      {
+         if (!LoopProbe(Session, Current, Probe))
+         {
+            LogPrint(LOG_ERROR, "EPP-2 NOT RESPONDING WHILE WAITING FOR THE NEXT DEVICE\r\n");
+            return FALSE;
+         }
+         if (Probe[0] != Previous[0] || Probe[1] != Previous[1])
+            Changed = ProgressTime();
+         Previous[0] = Probe[0];
+         Previous[1] = Probe[1];
+         // Timed by the clock, as each probe read takes longer than LOOP_POLL_TIME.
+         if ((ProgressTime() - Changed) * 1000 < Session->Config.LoopSettle)
+            continue;
+         // An empty socket which reads as blank can not be told from a blank device.
+         if (!Removed && (Probe[0] != Last[0] || Probe[1] != Last[1]))
+         {
+            Removed = TRUE;
+            if (Probe[2])
+            {
+               LogPrint(LOG_ERROR, "EMPTY SOCKET READS AS BLANK, PRESS ENTER FOR EACH DEVICE\r\n");
+               *Probing = FALSE;
+            }
+         }
+         else if (Removed && Probe[2])
+            return TRUE;
+      }
+   };
+
+   return FALSE;
+}
+
+
+
+/*******************************************************************/
+/* Perform the LOOP_STEPS on the device in the socket, over the    */
+/* whole device with the copy of the file at device addresses.     */
+/* Returns FALSE when a step fails.                                */
+/*******************************************************************/
+static short LoopDevice(SessionType* Session, LoopImageType* Current, unsigned long Count)
+{
+   char* Step;
+   short Passed;
+   double Start;
+   unsigned long Status[STATUS_COUNT];
+   ProgressType Progress;
+
+   for (Step = Session->Config.LoopSteps; *Step; ++Step)
+   {
+      LogPrint(LOG_INFO, "\r\nDEVICE %lu STEP %c\r\n", Count, *Step);
+      MetricsBegin(Session->Metrics, *Step);
+      Start = ProgressTime();
+      Passed = SessionSetRange(Session, 0, Current->Size - 1) && SessionSetOffset(Session, 0);
+      if (Passed && *Step == 'E')
+         Passed = SessionEmpty(Session);
+      else if (Passed)
+      {
+         ProgressStart(&Progress, (*Step == 'W') ? "WRITE" : "VERIFY", Current->Bytes, Session->Config.StatusFd);
+         if (*Step == 'W')
+            SessionWrite(Session, Current->Copy, 0, ADDRESS_MAX, &Progress);
+         else
+            SessionVerify(Session, Current->Copy, 0, ADDRESS_MAX, &Progress);
+         ProgressEnd(&Progress);
+         Passed = SessionStatus(Session, Status) && !Status[STATUS_ERROR];
+      }
+      MetricsOperation(Session->Metrics, *Step, Passed, (*Step == 'E') ? Current->Size : Current->Bytes, ProgressTime() - Start);
+      if (!Passed)
+      {
+         LogPrint(LOG_ERROR, "DEVICE %lu FAILED STEP %c\r\n", Count, *Step);
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+
+
+/**************************************************************************/
+/* Program one device after another without restarting, for production.   */
+/* The LOOP_STEPS are performed on the device in the socket, then the     */
+/* next device is waited for, detected by a LOOP_PROBE byte read of the   */
+/* socket or Enter from the operator. While a device is programmed the    */
+/* file is checked and copied again in a thread if it has changed.        */
+/* Ends with Ctrl-C. Returns FALSE if any device failed.                  */
+/**************************************************************************/
+short Loop(SessionType* Session, char* FileName, unsigned long Offset)
+{
+   short Result = TRUE;
+   short Console = TRUE;
+   short Probing;
+   short Started;
+   unsigned long Count = 0;
+   unsigned long Failed = 0;
+   unsigned long Last[3];
+   double Start;
+   double First;
+   double Ended;
+   pthread_t Thread;
+   LoopImageType Current;
+   LoopImageType Next;
+   void (*Interrupt)(int);
+
+   memset(&Current, 0, sizeof(Current));
+   Current.FileName = FileName;
+   Current.Offset = Offset;
+   Current.Size = DeviceSize(Session->DeviceCode);
+   Current.RecordSize = Session->Config.RecordSize;
+   LoopPrepare(&Current);
+   if (!Current.Size || !Current.Result)
+   {
+      LogPrint(LOG_ERROR, "FILE CHECK FAILED, DEVICE NOT USED: %s\r\n", FileName);
+      return FALSE;
+   }
+   LogPrint(LOG_INFO, "FILE LOADED: %s %lu BYTES %6.6lX - %6.6lX\r\n", FileName, Current.Bytes, Current.Start, Current.End);
+
+   Probing = Session->Config.LoopProbe != 0;
+   Interrupt = signal(SIGINT, LoopSignal);
+   First = Ended = ProgressTime();
+   while (!LoopStop)
+   {
+  /********************************************************************/
+ /* Program the device while the file is checked again in a thread.  */
+/********************************************************************/
+      Next = Current;
+      Started = !pthread_create(&Thread, NULL, LoopPrepare, &Next);
+      Start = ProgressTime();
+      ++Count;
+      // The cycle of a device runs from the end of the one before, including the change.
+      if (LoopDevice(Session, &Current, Count))
+         LogPrint(LOG_INFO, "\r\nDEVICE %lu PASSED IN %.1f s, CYCLE %.1f s\r\n", Count, ProgressTime() - Start, ProgressTime() - Ended);
+      else
+      {
+         ++Failed;
+         Result = FALSE;
+         LogPrint(LOG_ERROR, "\r\nDEVICE %lu FAILED IN %.1f s, CYCLE %.1f s\r\n", Count, ProgressTime() - Start, ProgressTime() - Ended);
+      }
+      Ended = ProgressTime();
+      if (!Started)
+         LoopPrepare(&Next);
+      else
+         pthread_join(Thread, NULL);
+
+  /*****************************************************************/
+ /* Wait for the next device, then use the latest file.           */
+/*****************************************************************/
+      Last[0] = Last[1] = Last[2] = 0;
+      if (!LoopTake(&Current, &Next) || LoopStop || (Probing && !LoopProbe(Session, &Current, Last)))
+         break;
+      LogFlush();
+      printf("\r\nCHANGE DEVICE%s, CTRL-C TO END\r\n", Console ? " OR PRESS ENTER" : "");
+      fflush(stdout);
+      if (!LoopWait(Session, &Current, Last, &Console, &Probing))
+         break;
+      Next = Current;
+      LoopPrepare(&Next);
+      if (!LoopTake(&Current, &Next))
+         break;
+   };
+   signal(SIGINT, Interrupt);
+   remove(Current.Copy);
+
+   LogFlush();
+   printf("\r\n%lu DEVICES, %lu PASSED, %lu FAILED IN %.1f s\r\n", Count, Count - Failed, Failed, ProgressTime() - First);
 
    return Result;
 }
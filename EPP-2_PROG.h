@@ -26,32 +26,38 @@
 #define ARG_START_ADR         3
 #define ARG_END_ADR           4
 #define ARG_DATA_FILE         4
+#define ARG_JOB_FILE          2
 
-#define FALSE                 0
-#define TRUE                  1
-#define PROMPT                2
-#define BUFF_SIZE             255
+#define RANGE_MAX             64
+// Record sizes tried by the K operation, and the longest time for one baud rate.
+#define CALIBRATE_SIZES       4
+#define CALIBRATE_MAX_TIME    120
+// Time in ms without a change before a watched file is loaded.
+#define WATCH_SETTLE_TIME     500
+#define WATCH_EVENT_SIZE      4096
+// Journal of the chunks of an F operation committed to its file, and the
+// times a chunk failing its sumcheck is read again.
+#define CHUNK_JOURNAL         "%s.JRN"
+#define CHUNK_RETRIES         3
+// Time between reads of the probe range of the L operation for the
+// next device in ms, and the copy of its file in device address records.
+#define LOOP_POLL_TIME        250
+#define LOOP_FILE             "/tmp/EPP-2_LOOP.XXXXXX"
 
 
-typedef struct
-{
-   unsigned char SerialPort[BUFF_SIZE+1];
-   unsigned char BaudRate[BUFF_SIZE+1];
-} ConfigType;
-
-
-void WaitForPrompt(int SerialPort);
-void SelectBaudRate(struct termios* tty, unsigned char* BaudRate);
-unsigned char* ChrReplace(unsigned char* Data, unsigned char Find, unsigned char Replace);
-void SendData(unsigned char Silent, int SerialPort, char* Data);
-short ReceiveData(unsigned char Silent, int SerialPort, char* Data, int TimeOut, FILE* OutStream);
+short Operation(SessionType* Session, int argc, char* argv[], ImageType* Image, RangeType* Ranges, short RangeCount, IndexType* Index);
+short Identify(SessionType* Session, IndexType* Index);
+short Locate(SessionType* Session, ImageType* Image);
+short Calibrate(SessionType* Session, unsigned long Start, unsigned long End);
+short Watch(SessionType* Session, char* FileName, unsigned long Offset);
+short ReadChunks(SessionType* Session, char* FileName, unsigned long Start);
+short Loop(SessionType* Session, char* FileName, unsigned long Offset);
+short ParseRanges(char* Text, RangeType* Ranges, short MaxRanges);
+unsigned long RangeTotal(int argc, char* argv[], int DeviceCode, RangeType* Ranges, short RangeCount);
+short RangeRead(SessionType* Session, short First, short Last, ProgressType* Progress);
+void EstimateOperation(EstimateType* Estimate, int argc, char* argv[], ImageType* Image, RangeType* Ranges, short RangeCount, ConfigType* Config);
 
 
-unsigned char* BaudRates[] = 
-{
-   "19200", "9600", "4800", "2400", "1200", "600", "300", NULL,
-};
-
 unsigned char* EPROM_Size[16] = 
 {
    "INVALID", "2 x 8 Kbit", "4 x 8 Kbit", "8 x 8 KBit", "16 x 8 Kbit",
@@ -0,0 +1,169 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* Estimate - Predicted duration of an operation, without a programmer.     */
+/* ------------------------------------------------------------------------ */
+/* The model adds the time to set up the EPP-2, the time to send or receive */
+/* the S records at the baud rate and the time the EPP-2 spends on the      */
+/* device: programming each byte with the pulse time and margin factor of   */
+/* the device code, or reading each byte. The model is then multiplied by   */
+/* a calibration factor, the average ratio of the measured time to the      */
+/* model over recent runs of the operation with the device code, or with    */
+/* any device code if there are none. Each completed run updates the        */
+/* calibration file, one line for each operation and device code:           */
+/* [OPERATION] [DEVICE] [FACTOR] [RUNS]                                     */
+/****************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include "Session.h"
+#include "Estimate.h"
+
+
+typedef struct
+{
+   char Operation;
+   int DeviceCode;
+   double Factor;
+   unsigned long Runs;
+} EstimateEntryType;
+
+
+
+/**************************************************************/
+/* Read the calibration file, returns the number of entries.  */
+/**************************************************************/
+static short EstimateRead(char* FileName, EstimateEntryType* Entries)
+{
+   FILE* File;
+   short Count = 0;
+   char Buffer[BUFF_SIZE + 1];
+
+   if (!(File = fopen(FileName, "rt")))
+      return 0;
+   while (Count < ESTIMATE_MAX_ENTRIES && fgets(Buffer, BUFF_SIZE, File))
+      if (sscanf(Buffer, "%c %X %lf %lu", &(Entries[Count].Operation), &(Entries[Count].DeviceCode), &(Entries[Count].Factor), &(Entries[Count].Runs)) == 4
+         && Entries[Count].Factor > 0)
+         ++Count;
+   fclose(File);
+
+   return Count;
+}
+
+
+
+/*****************************************************************/
+/* Model the time of the operation, from the bytes and the       */
+/* characters of the operation, the baud rate and device code.   */
+/*****************************************************************/
+void EstimateModel(EstimateType* Estimate)
+{
+   double CharTime = (double)ESTIMATE_CHAR_BITS / (Estimate->BaudRate > 0 ? Estimate->BaudRate : 9600);
+
+   Estimate->Setup = ESTIMATE_SETUP_TIME;
+   Estimate->Transfer = 0;
+   Estimate->Device = Estimate->Bytes * ESTIMATE_CHECK_TIME / 1000000.0;
+   // R receives a line of S record characters for each record of the range.
+   if (Estimate->Operation == 'R')
+      Estimate->Characters = (Estimate->Bytes + ESTIMATE_READ_RECORD - 1) / ESTIMATE_READ_RECORD * ESTIMATE_READ_LINE;
+   Estimate->Transfer = Estimate->Characters * CharTime;
+   if (Estimate->Operation == 'W')
+      Estimate->Device = Estimate->ProgramBytes * (double)DeviceByteTime(Estimate->DeviceCode) / 1000000.0;
+   Estimate->Model = Estimate->Setup + Estimate->Transfer + Estimate->Device;
+   Estimate->Time = Estimate->Model;
+}
+
+
+
+/******************************************************************/
+/* Apply the calibration of the operation with the device code,   */
+/* or the average calibration of the operation if there is none.  */
+/******************************************************************/
+void EstimateCalibrate(EstimateType* Estimate, char* FileName)
+{
+   short Count;
+   short EntryCount;
+   double Total = 0;
+   EstimateEntryType Entries[ESTIMATE_MAX_ENTRIES];
+
+   Estimate->Factor = 1.0;
+   Estimate->Runs = 0;
+   Estimate->Average = FALSE;
+   EntryCount = EstimateRead(FileName, Entries);
+   for (Count = 0; Count < EntryCount; ++Count)
+   {
+      if (Entries[Count].Operation != Estimate->Operation)
+         continue;
+      if (Entries[Count].DeviceCode == Estimate->DeviceCode)
+      {
+         Estimate->Factor = Entries[Count].Factor;
+         Estimate->Runs = Entries[Count].Runs;
+         Estimate->Average = FALSE;
+         break;
+      }
+      Total += Entries[Count].Factor * Entries[Count].Runs;
+      Estimate->Runs += Entries[Count].Runs;
+      Estimate->Average = TRUE;
+   }
+   if (Estimate->Average && Estimate->Runs)
+      Estimate->Factor = Total / Estimate->Runs;
+   Estimate->Time = Estimate->Model * Estimate->Factor;
+}
+
+
+
+/********************************************************************/
+/* Add a completed run of Seconds to the calibration of the         */
+/* operation with the device code. Returns FALSE on a write error.  */
+/********************************************************************/
+short EstimateUpdate(EstimateType* Estimate, char* FileName, double Seconds)
+{
+   FILE* File;
+   short Count;
+   short EntryCount;
+   EstimateEntryType Entries[ESTIMATE_MAX_ENTRIES];
+
+   if (Estimate->Model <= 0 || Seconds <= 0)
+      return FALSE;
+   EntryCount = EstimateRead(FileName, Entries);
+   for (Count = 0; Count < EntryCount && (Entries[Count].Operation != Estimate->Operation || Entries[Count].DeviceCode != Estimate->DeviceCode); ++Count);
+   if (Count == EntryCount)
+   {
+      if (EntryCount == ESTIMATE_MAX_ENTRIES)
+         return FALSE;
+      Entries[Count].Operation = Estimate->Operation;
+      Entries[Count].DeviceCode = Estimate->DeviceCode;
+      Entries[Count].Factor = 0;
+      Entries[Count].Runs = 0;
+      ++EntryCount;
+   }
+   // Running average, weighting the recent runs once there are enough.
+   if (Entries[Count].Runs < ESTIMATE_RUNS)
+      ++Entries[Count].Runs;
+   Entries[Count].Factor += (Seconds / Estimate->Model - Entries[Count].Factor) / Entries[Count].Runs;
+
+   if (!(File = fopen(FileName, "wt")))
+   {
+      LogPrint(LOG_ERROR, "Failed to open calibration file for writing: %s\r\n", FileName);
+      return FALSE;
+   }
+   for (Count = 0; Count < EntryCount; ++Count)
+      fprintf(File, "%c %6.6X %.4f %lu\n", Entries[Count].Operation, Entries[Count].DeviceCode, Entries[Count].Factor, Entries[Count].Runs);
+
+   return fclose(File) ? FALSE : TRUE;
+}
@@ -0,0 +1,71 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef __ESTIMATE_H
+#define __ESTIMATE_H
+
+
+#ifndef FALSE
+#define FALSE                 0
+#endif
+#ifndef TRUE
+#define TRUE                  1
+#endif
+
+// Calibration of the model from the runs of each operation and device.
+#define ESTIMATE_FILE         "EPP-2_PROG.CAL"
+#define ESTIMATE_MAX_ENTRIES  256
+// A calibration follows the average of about this many recent runs.
+#define ESTIMATE_RUNS         16
+// Seconds to find the prompt and configure the EPP-2 for an operation.
+#define ESTIMATE_SETUP_TIME   0.5
+// Time for the EPP-2 to read or compare a byte of the device, us.
+#define ESTIMATE_CHECK_TIME   10.0
+// The R operation receives records of 32 bytes, S3 lines of 80 characters.
+#define ESTIMATE_READ_RECORD  32
+#define ESTIMATE_READ_LINE    80
+// Bits sent for each character, start, 8 data & stop bits.
+#define ESTIMATE_CHAR_BITS    10
+
+
+typedef struct
+{
+   unsigned char Operation;
+   int DeviceCode;
+   int BaudRate;
+   // Bytes of the range or image, bytes programmed and characters sent.
+   unsigned long Bytes;
+   unsigned long ProgramBytes;
+   unsigned long Characters;
+   // Parts of the model, the calibration and the estimate, in seconds.
+   double Setup;
+   double Transfer;
+   double Device;
+   double Model;
+   double Factor;
+   unsigned long Runs;
+   short Average;
+   double Time;
+} EstimateType;
+
+
+void EstimateModel(EstimateType* Estimate);
+void EstimateCalibrate(EstimateType* Estimate, char* FileName);
+short EstimateUpdate(EstimateType* Estimate, char* FileName, double Seconds);
+
+
+#endif
@@ -0,0 +1,755 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* Image - EPROM address space image of a Motorola S record file.           */
+/* ------------------------------------------------------------------------ */
+/* Parse Motorola S record files into a memory image of the EPROM address   */
+/* space, recording which locations are populated. While loading, the sum   */
+/* of the data bytes is accumulated so the EPP-2 sumcheck of a range can be */
+/* calculated on the host without reading the device.                       */
+/****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Image.h"
+#include "Log.h"
+
+
+
+/********************************************************/
+/* Allocate an empty image of the largest EPP-2 device. */
+/********************************************************/
+short ImageCreate(ImageType* Image)
+{
+   memset(Image, 0, sizeof(ImageType));
+   Image->Data = malloc(IMAGE_MAX_SIZE);
+   Image->Used = calloc(IMAGE_MAX_SIZE, 1);
+   if (!Image->Data || !Image->Used)
+   {
+      ImageFree(Image);
+      return FALSE;
+   }
+   memset(Image->Data, IMAGE_ERASED, IMAGE_MAX_SIZE);
+
+   return TRUE;
+}
+
+
+
+void ImageFree(ImageType* Image)
+{
+   free(Image->Data);
+   free(Image->Used);
+   Image->Data = NULL;
+   Image->Used = NULL;
+}
+
+
+
+/**************************************************************/
+/* Convert two hex characters to a byte value, -1 if invalid. */
+/**************************************************************/
+short HexByte(char* Text)
+{
+   short Count;
+   short Value = 0;
+
+   for (Count = 0; Count < 2; ++Count)
+   {
+      Value <<= 4;
+      if (Text[Count] >= '0' && Text[Count] <= '9')
+         Value |= Text[Count] - '0';
+      else if (Text[Count] >= 'A' && Text[Count] <= 'F')
+         Value |= Text[Count] - 'A' + 10;
+      else if (Text[Count] >= 'a' && Text[Count] <= 'f')
+         Value |= Text[Count] - 'a' + 10;
+      else
+         return -1;
+   }
+
+   return Value;
+}
+
+
+
+/**************************************************************/
+/* Store a byte in the image, keeping the data sum, the count */
+/* and the range of the populated locations up to date.       */
+/**************************************************************/
+static void ImageStore(ImageType* Image, unsigned long Address, unsigned char Value)
+{
+   if (Image->Used[Address])
+      Image->CheckSum -= Image->Data[Address];
+   else
+   {
+      Image->Used[Address] = TRUE;
+      if (!Image->ByteCount || Address < Image->Start)
+         Image->Start = Address;
+      if (!Image->ByteCount || Address > Image->End)
+         Image->End = Address;
+      ++Image->ByteCount;
+   }
+   Image->Data[Address] = Value;
+   Image->CheckSum += Value;
+}
+
+
+
+/****************************************************************/
+/* Load the data records of a Motorola S record file into the   */
+/* image. The Offset is subtracted from each record address, in */
+/* the same way the EPP-2 relocates a file with the O command.  */
+/****************************************************************/
+short ImageLoadMotorola(ImageType* Image, char* FileName, unsigned long Offset)
+{
+   FILE* File;
+   short Result;
+
+   if (!(File = fopen(FileName, "rt")))
+   {
+      LogPrint(LOG_ERROR, "Failed to open Motorola S-Record file: %s\r\n", FileName);
+      return FALSE;
+   }
+   Result = ImageReadMotorola(Image, File, FileName, Offset);
+   fclose(File);
+
+   return Result;
+}
+
+
+
+/********************************************************************/
+/* Load the data records of Motorola S records from an open stream, */
+/* such as the records read from a device. FileName is only used    */
+/* in error messages.                                               */
+/********************************************************************/
+short ImageReadMotorola(ImageType* Image, FILE* File, char* FileName, unsigned long Offset)
+{
+   short Value;
+   short AddressSize;
+   unsigned short Count;
+   unsigned short ByteCount;
+   unsigned char CheckSum;
+   unsigned long Line = 0;
+   unsigned long Address;
+   char Buffer[IMAGE_LINE_SIZE + 1];
+
+   while (fgets(Buffer, IMAGE_LINE_SIZE, File))
+   {
+      ++Line;
+      if (Buffer[0] != 'S')
+         continue;
+  /*************************************************/
+ /* Only S1, S2 & S3 records carry EPROM content. */
+/*************************************************/
+      if (Buffer[1] == '1')
+         AddressSize = 2;
+      else if (Buffer[1] == '2')
+         AddressSize = 3;
+      else if (Buffer[1] == '3')
+         AddressSize = 4;
+      else
+         continue;
+
+      if ((Value = HexByte(&(Buffer[2]))) < AddressSize + 1)
+         break;
+      ByteCount = Value;
+      CheckSum = ByteCount;
+      Address = 0;
+      for (Count = 0; Count < ByteCount - 1; ++Count)
+      {
+         if ((Value = HexByte(&(Buffer[4 + 2 * Count]))) < 0)
+            break;
+         CheckSum += Value;
+         if (Count < AddressSize)
+            Address = (Address << 8) | Value;
+      }
+      if (Count != ByteCount - 1 || (unsigned char)~CheckSum != HexByte(&(Buffer[4 + 2 * Count])))
+         break;
+
+      if (Address < Offset || Address - Offset + ByteCount - AddressSize - 1 > IMAGE_MAX_SIZE)
+      {
+         LogPrint(LOG_ERROR, "S-RECORD ADDRESS OUT OF RANGE: %s LINE %lu\r\n", FileName, Line);
+         return FALSE;
+      }
+      Address -= Offset;
+
+  /***********************************************************/
+ /* Store the record data, keeping the data sum up to date. */
+/***********************************************************/
+      for (Count = AddressSize; Count < ByteCount - 1; ++Count, ++Address)
+      {
+         ImageStore(Image, Address, HexByte(&(Buffer[4 + 2 * Count])));
+      }
+      ++Image->RecordCount;
+   };
+
+   if (!feof(File))
+   {
+      LogPrint(LOG_ERROR, "INVALID S-RECORD: %s LINE %lu\r\n", FileName, Line);
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+
+/*******************************************************************/
+/* Load the data records of an Intel HEX file into the image. The  */
+/* extended segment and extended linear address records set the    */
+/* upper address bits. The Offset is subtracted from each address. */
+/*******************************************************************/
+short ImageLoadIntel(ImageType* Image, char* FileName, unsigned long Offset)
+{
+   FILE* File;
+   short Value;
+   short Type = 0;
+   unsigned short Count;
+   unsigned short ByteCount;
+   unsigned char CheckSum;
+   unsigned long Line = 0;
+   unsigned long Base = 0;
+   unsigned long Address;
+   unsigned char Data[IMAGE_LINE_SIZE / 2];
+   char Buffer[IMAGE_LINE_SIZE + 1];
+
+   if (!(File = fopen(FileName, "rt")))
+   {
+      LogPrint(LOG_ERROR, "Failed to open Intel HEX file: %s\r\n", FileName);
+      return FALSE;
+   }
+
+   while (fgets(Buffer, IMAGE_LINE_SIZE, File))
+   {
+      ++Line;
+      if (Buffer[0] != ':')
+         continue;
+  /****************************************************/
+ /* :LLAAAATT[DATA]CC, the sum of all bytes is zero. */
+/****************************************************/
+      if ((Value = HexByte(&(Buffer[1]))) < 0 || strlen(Buffer) < 11 + 2 * Value)
+         break;
+      ByteCount = Value;
+      CheckSum = 0;
+      for (Count = 0; Count < ByteCount + 5; ++Count)
+      {
+         if ((Value = HexByte(&(Buffer[1 + 2 * Count]))) < 0)
+            break;
+         CheckSum += Value;
+         if (Count >= 4)
+            Data[Count - 4] = Value;
+      }
+      if (Count != ByteCount + 5 || CheckSum)
+         break;
+      Address = (HexByte(&(Buffer[3])) << 8) | HexByte(&(Buffer[5]));
+      Type = HexByte(&(Buffer[7]));
+
+      if (Type == 0x01)
+         break;
+      else if (Type == 0x02 && ByteCount == 2)
+         Base = ((Data[0] << 8) | Data[1]) << 4;
+      else if (Type == 0x04 && ByteCount == 2)
+         Base = (unsigned long)((Data[0] << 8) | Data[1]) << 16;
+      else if (Type == 0x00)
+      {
+         Address += Base;
+         if (Address < Offset || Address - Offset + ByteCount > IMAGE_MAX_SIZE)
+         {
+            LogPrint(LOG_ERROR, "INTEL HEX ADDRESS OUT OF RANGE: %s LINE %lu\r\n", FileName, Line);
+            fclose(File);
+            return FALSE;
+         }
+         for (Count = 0; Count < ByteCount; ++Count)
+            ImageStore(Image, Address - Offset + Count, Data[Count]);
+         ++Image->RecordCount;
+      }
+   };
+
+   // The end of file record or the end of the file ends the data.
+   if (!feof(File) && Type != 0x01)
+   {
+      LogPrint(LOG_ERROR, "INVALID INTEL HEX RECORD: %s LINE %lu\r\n", FileName, Line);
+      fclose(File);
+      return FALSE;
+   }
+   fclose(File);
+
+   return TRUE;
+}
+
+
+
+/**********************************************************************/
+/* Load a Motorola S record, Intel HEX or binary file into the image, */
+/* by the first character of the file, 'S' or ':', otherwise binary.  */
+/* The Offset is subtracted from record addresses, a binary file is   */
+/* loaded from address 0.                                             */
+/**********************************************************************/
+short ImageLoadFile(ImageType* Image, char* FileName, unsigned long Offset)
+{
+   FILE* File;
+   int First;
+
+   if (!(File = fopen(FileName, "rb")))
+   {
+      LogPrint(LOG_ERROR, "Failed to open file: %s\r\n", FileName);
+      return FALSE;
+   }
+   First = fgetc(File);
+   fclose(File);
+
+   if (First == 'S')
+      return ImageLoadMotorola(Image, FileName, Offset);
+   if (First == ':')
+      return ImageLoadIntel(Image, FileName, Offset);
+
+   return ImageLoadBinary(Image, FileName, 0);
+}
+
+
+
+/***************************************************************/
+/* Load a binary file into the image, from the Start address.  */
+/***************************************************************/
+short ImageLoadBinary(ImageType* Image, char* FileName, unsigned long Start)
+{
+   FILE* File;
+   int Value;
+   unsigned long Address;
+
+   if (!(File = fopen(FileName, "rb")))
+   {
+      LogPrint(LOG_ERROR, "Failed to open binary file: %s\r\n", FileName);
+      return FALSE;
+   }
+
+   for (Address = Start; (Value = fgetc(File)) != EOF; ++Address)
+   {
+      if (Address >= IMAGE_MAX_SIZE)
+      {
+         LogPrint(LOG_ERROR, "BINARY FILE TOO LARGE: %s\r\n", FileName);
+         fclose(File);
+         return FALSE;
+      }
+      ImageStore(Image, Address, Value);
+   }
+   fclose(File);
+
+   return TRUE;
+}
+
+
+
+/********************************************************************/
+/* Calculate the EPP-2 sumcheck, the binary sum of every byte in    */
+/* the address range. Unpopulated locations are taken to be erased. */
+/********************************************************************/
+unsigned long ImageCheckSum(ImageType* Image, unsigned long Start, unsigned long End)
+{
+   unsigned long Address;
+   unsigned long CheckSum = 0;
+
+   if (Image->ByteCount && Start <= Image->Start && End >= Image->End)
+      return (Image->CheckSum + (End - Start + 1 - Image->ByteCount) * IMAGE_ERASED) & 0xFFFFFFFF;
+
+   for (Address = Start; Address <= End && Address < IMAGE_MAX_SIZE; ++Address)
+      CheckSum += Image->Data[Address];
+
+   return CheckSum & 0xFFFFFFFF;
+}
+
+
+
+/**************************************************************/
+/* Get the address and data length of an S1, S2 or S3 record. */
+/* Returns FALSE for other record types.                      */
+/**************************************************************/
+short ImageRecordInfo(char* Record, unsigned long* Address, unsigned short* Length)
+{
+   short Count;
+   short Value;
+   short AddressSize;
+
+   if (Record[0] != 'S' || Record[1] < '1' || Record[1] > '3')
+      return FALSE;
+   AddressSize = Record[1] - '0' + 1;
+   if ((Value = HexByte(&(Record[2]))) < AddressSize + 1)
+      return FALSE;
+   *Length = Value - AddressSize - 1;
+   *Address = 0;
+   for (Count = 0; Count < AddressSize; ++Count)
+   {
+      if ((Value = HexByte(&(Record[4 + 2 * Count]))) < 0)
+         return FALSE;
+      *Address = (*Address << 8) | Value;
+   }
+
+   return TRUE;
+}
+
+
+
+/********************************************************************/
+/* List the populated address ranges of the image, combining ranges */
+/* separated by no more than Gap unpopulated locations. Returns the */
+/* number of ranges, or -1 if there are more than MaxRanges.        */
+/********************************************************************/
+short ImageRanges(ImageType* Image, RangeType* Ranges, short MaxRanges, unsigned long Gap)
+{
+   short Count = 0;
+   unsigned long Address;
+
+   if (!Image->ByteCount)
+      return 0;
+
+   for (Address = Image->Start; Address <= Image->End; ++Address)
+   {
+      if (!Image->Used[Address])
+         continue;
+      if (Count && Address - Ranges[Count - 1].End <= Gap + 1)
+         Ranges[Count - 1].End = Address;
+      else if (Count == MaxRanges)
+         return -1;
+      else
+      {
+         Ranges[Count].Start = Address;
+         Ranges[Count++].End = Address;
+      }
+   }
+
+   return Count;
+}
+
+
+
+/********************************************************/
+/* Number of populated locations in the address range.  */
+/********************************************************/
+unsigned long ImageCount(ImageType* Image, unsigned long Start, unsigned long End)
+{
+   unsigned long Address;
+   unsigned long Count = 0;
+
+   for (Address = Start; Address <= End && Address < IMAGE_MAX_SIZE; ++Address)
+      Count += Image->Used[Address];
+
+   return Count;
+}
+
+
+
+/**********************************************************************/
+/* Write one S3 data record of Length bytes to a Motorola S record    */
+/* file, in the same form as the BinToMotorola utility.               */
+/**********************************************************************/
+void ImageMotorolaRecord(FILE* File, unsigned long Address, unsigned char* Data, short Length)
+{
+   short Count;
+   unsigned char CheckSum;
+
+   CheckSum = 5 + Length + (Address & 0xFF) + ((Address >> 8) & 0xFF) + ((Address >> 16) & 0xFF) + ((Address >> 24) & 0xFF);
+   fprintf(File, "S3%2.2X%8.8lX", (5 + Length) & 0xFF, Address & 0xFFFFFFFF);
+   for (Count = 0; Count < Length; ++Count)
+   {
+      fprintf(File, "%2.2X", Data[Count]);
+      CheckSum += Data[Count];
+   }
+   fprintf(File, "%2.2X\r\n", (unsigned char)~CheckSum);
+}
+
+
+
+/***************************************************************/
+/* Write the S7 record terminating a Motorola S record file.   */
+/***************************************************************/
+void ImageMotorolaEnd(FILE* File, unsigned long Address)
+{
+   unsigned char CheckSum;
+
+   CheckSum = 5 + (Address & 0xFF) + ((Address >> 8) & 0xFF) + ((Address >> 16) & 0xFF) + ((Address >> 24) & 0xFF);
+   fprintf(File, "S705%8.8lX%2.2X\r\n", Address & 0xFFFFFFFF, (unsigned char)~CheckSum);
+}
+
+
+
+/**************************************************************/
+/* Populate the address range of the image with one Value.    */
+/**************************************************************/
+void ImageFill(ImageType* Image, unsigned long Start, unsigned long End, unsigned char Value)
+{
+   unsigned long Address;
+
+   for (Address = Start; Address <= End && Address < IMAGE_MAX_SIZE; ++Address)
+      ImageStore(Image, Address, Value);
+}
+
+
+
+/*******************************************************************/
+/* Merge the populated locations of the Next image into the image. */
+/* A location populated in both is kept with IMAGE_OVERLAP_FIRST,  */
+/* replaced with IMAGE_OVERLAP_LAST, and with IMAGE_OVERLAP_ERROR  */
+/* the images are only merged if every such location holds the     */
+/* same value. Overlaps is set to the locations populated in both, */
+/* and Conflicts to those holding different values. Returns FALSE  */
+/* if the images were not merged.                                  */
+/*******************************************************************/
+short ImageMerge(ImageType* Image, ImageType* Next, short Policy, unsigned long* Overlaps, unsigned long* Conflicts)
+{
+   unsigned long Address;
+
+   *Overlaps = 0;
+   *Conflicts = 0;
+   for (Address = Next->Start; Next->ByteCount && Address <= Next->End; ++Address)
+      if (Next->Used[Address] && Image->Used[Address])
+      {
+         ++*Overlaps;
+         if (Next->Data[Address] != Image->Data[Address])
+         {
+            if (!*Conflicts && Policy == IMAGE_OVERLAP_ERROR)
+               LogPrint(LOG_ERROR, "OVERLAPPING DATA DIFFERS AT %6.6lX: %2.2X %2.2X\r\n", Address, Image->Data[Address], Next->Data[Address]);
+            ++*Conflicts;
+         }
+      }
+   if (*Conflicts && Policy == IMAGE_OVERLAP_ERROR)
+      return FALSE;
+
+   for (Address = Next->Start; Next->ByteCount && Address <= Next->End; ++Address)
+      if (Next->Used[Address] && (!Image->Used[Address] || Policy == IMAGE_OVERLAP_LAST))
+         ImageStore(Image, Address, Next->Data[Address]);
+   Image->RecordCount += Next->RecordCount;
+
+   return TRUE;
+}
+
+
+
+/*********************************************************************/
+/* Write the populated locations of the image to a Motorola S record */
+/* file, in records of up to RecordSize bytes. A record ends at each */
+/* unpopulated location, so the gaps are not programmed.             */
+/*********************************************************************/
+short ImageWriteMotorola(ImageType* Image, char* FileName, short RecordSize)
+{
+   FILE* File;
+   short Length;
+   unsigned long Address;
+
+   if (!(File = fopen(FileName, "wb")))
+   {
+      LogPrint(LOG_ERROR, "Failed to create Motorola S-Record file: %s\r\n", FileName);
+      return FALSE;
+   }
+
+   for (Address = Image->Start; Image->ByteCount && Address <= Image->End; Address += Length)
+   {
+      for (Length = 0; Length < RecordSize && Address + Length <= Image->End && Image->Used[Address + Length]; ++Length);
+      if (!Length)
+         Length = 1;
+      else
+         ImageMotorolaRecord(File, Address, &(Image->Data[Address]), Length);
+   }
+   ImageMotorolaEnd(File, 0);
+
+   return fclose(File) ? FALSE : TRUE;
+}
+
+
+
+/***********************************************************************/
+/* Write the records of the image which differ from a Previous image,  */
+/* such as the image last programmed, to a Motorola S record file. The */
+/* image is compared in blocks of RecordSize bytes, only the blocks    */
+/* with a populated location which is new or has a new value are       */
+/* written. Returns the number of data bytes written, -1 on failure.   */
+/***********************************************************************/
+long ImageWriteChanges(ImageType* Image, ImageType* Previous, char* FileName, short RecordSize)
+{
+   FILE* File;
+   short Length;
+   long Bytes = 0;
+   unsigned long Block;
+   unsigned long BlockEnd;
+   unsigned long Address;
+
+   if (!(File = fopen(FileName, "wb")))
+   {
+      LogPrint(LOG_ERROR, "Failed to create Motorola S-Record file: %s\r\n", FileName);
+      return -1;
+   }
+
+   for (Block = Image->Start; Image->ByteCount && Block <= Image->End; Block += RecordSize)
+   {
+      BlockEnd = (Image->End - Block < RecordSize) ? Image->End + 1 : Block + RecordSize;
+      if (!memcmp(&(Image->Data[Block]), &(Previous->Data[Block]), BlockEnd - Block)
+         && !memcmp(&(Image->Used[Block]), &(Previous->Used[Block]), BlockEnd - Block))
+         continue;
+      for (Address = Block; Address < BlockEnd && (!Image->Used[Address] || (Previous->Used[Address] && Image->Data[Address] == Previous->Data[Address])); ++Address);
+      if (Address == BlockEnd)
+         continue;
+      // Write each populated run of the block.
+      for (Address = Block; Address < BlockEnd; Address += Length ? Length : 1)
+      {
+         for (Length = 0; Address + Length < BlockEnd && Image->Used[Address + Length]; ++Length);
+         if (Length)
+            ImageMotorolaRecord(File, Address, &(Image->Data[Address]), Length);
+         Bytes += Length;
+      }
+   }
+   ImageMotorolaEnd(File, 0);
+
+   return fclose(File) ? -1 : Bytes;
+}
+
+
+
+/*****************************************************/
+/* Order assets by start address, for qsort().       */
+/*****************************************************/
+static int AssetCompare(const void* Left, const void* Right)
+{
+   if (((AssetType*)Left)->Start < ((AssetType*)Right)->Start)
+      return -1;
+
+   return ((AssetType*)Left)->Start > ((AssetType*)Right)->Start;
+}
+
+
+
+/**********************************************************************/
+/* Read a manifest of binary assets, one line for each asset:         */
+/* [START_ADR] [END_ADR] [BIN_FILE] <FILL>                            */
+/* The FILL value pads the range after the file, FF if not given.     */
+/* Blank lines and lines starting with # are ignored. The assets are  */
+/* sorted by start address, so an asset overlapping any other asset   */
+/* overlaps the end of the furthest reaching asset before it.         */
+/* Returns FALSE if the file is invalid or any of the assets overlap. */
+/**********************************************************************/
+short ImageReadManifest(ManifestType* Manifest, char* FileName)
+{
+   FILE* File;
+   short Result = TRUE;
+   short Count;
+   short Last = 0;
+   short Line = 0;
+   int Fields;
+   char First;
+   AssetType* Asset;
+   char Fill[IMAGE_LINE_SIZE + 1];
+   char Buffer[IMAGE_LINE_SIZE + 1];
+
+   memset(Manifest, 0, sizeof(ManifestType));
+   if (!(File = fopen(FileName, "rt")))
+   {
+      LogPrint(LOG_ERROR, "Failed to open manifest file: %s\r\n", FileName);
+      return FALSE;
+   }
+
+   while (fgets(Buffer, IMAGE_LINE_SIZE, File))
+   {
+      ++Line;
+      if (sscanf(Buffer, " %c", &First) != 1 || First == '#')
+         continue;
+      if (!(Asset = realloc(Manifest->Assets, (Manifest->Count + 1) * sizeof(AssetType))))
+      {
+         Result = FALSE;
+         break;
+      }
+      Manifest->Assets = Asset;
+      Asset = &(Manifest->Assets[Manifest->Count++]);
+      Asset->Fill = IMAGE_ERASED;
+      Fields = sscanf(Buffer, "%lX %lX %255s %255s", &(Asset->Start), &(Asset->End), Asset->FileName, Fill);
+      // A FILL of - leaves the rest of the range unpopulated.
+      if (Fields == 4)
+         Asset->Fill = strcmp(Fill, "-") ? strtoul(Fill, NULL, 16) & 0xFF : -1;
+      if (Fields < 3 || Asset->Start > Asset->End || Asset->End >= IMAGE_MAX_SIZE)
+      {
+         LogPrint(LOG_ERROR, "INVALID MANIFEST LINE %d: %s\r\n", Line, FileName);
+         Result = FALSE;
+      }
+   }
+   fclose(File);
+
+  /********************************************/
+ /* Sort the assets and check for overlaps.  */
+/********************************************/
+   if (Result && Manifest->Count)
+   {
+      qsort(Manifest->Assets, Manifest->Count, sizeof(AssetType), AssetCompare);
+      for (Count = 1; Count < Manifest->Count; ++Count)
+      {
+         if (Manifest->Assets[Count].Start <= Manifest->Assets[Last].End)
+         {
+            LogPrint(LOG_ERROR, "ASSETS OVERLAP: %6.6lX - %6.6lX %s AND %6.6lX - %6.6lX %s\r\n",
+               Manifest->Assets[Last].Start, Manifest->Assets[Last].End, Manifest->Assets[Last].FileName,
+               Manifest->Assets[Count].Start, Manifest->Assets[Count].End, Manifest->Assets[Count].FileName);
+            Result = FALSE;
+         }
+         if (Manifest->Assets[Count].End > Manifest->Assets[Last].End)
+            Last = Count;
+      }
+   }
+   if (!Result)
+      ImageFreeManifest(Manifest);
+
+   return Result;
+}
+
+
+
+/********************************************************************/
+/* Load the binary file of each asset of a manifest into the image. */
+/* A file longer than its range is truncated, with a warning.       */
+/********************************************************************/
+short ImageLoadManifest(ImageType* Image, ManifestType* Manifest)
+{
+   FILE* File;
+   short Count;
+   int Value;
+   unsigned long Address;
+   AssetType* Asset;
+
+   for (Count = 0; Count < Manifest->Count; ++Count)
+   {
+      Asset = &(Manifest->Assets[Count]);
+      if (!(File = fopen(Asset->FileName, "rb")))
+      {
+         LogPrint(LOG_ERROR, "Failed to open binary file: %s\r\n", Asset->FileName);
+         return FALSE;
+      }
+      for (Address = Asset->Start; Address <= Asset->End && (Value = fgetc(File)) != EOF; ++Address)
+         ImageStore(Image, Address, Value);
+      if (Address > Asset->End && fgetc(File) != EOF)
+         LogPrint(LOG_ERROR, "FILE TRUNCATED AT %6.6lX: %s\r\n", Asset->End, Asset->FileName);
+      fclose(File);
+      if (Asset->Fill >= 0 && Address <= Asset->End)
+         ImageFill(Image, Address, Asset->End, Asset->Fill);
+   }
+
+   return TRUE;
+}
+
+
+
+void ImageFreeManifest(ManifestType* Manifest)
+{
+   free(Manifest->Assets);
+   memset(Manifest, 0, sizeof(ManifestType));
+}
@@ -0,0 +1,110 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef __IMAGE_H
+#define __IMAGE_H
+
+
+#include <stdio.h>
+
+
+#ifndef FALSE
+#define FALSE                 0
+#endif
+#ifndef TRUE
+#define TRUE                  1
+#endif
+
+// Largest EPP-2 device, 1024 x 8 Kbit.
+#define IMAGE_MAX_SIZE        0x100000
+// Value of an unprogrammed EPROM location.
+#define IMAGE_ERASED          0xFF
+#define IMAGE_LINE_SIZE       255
+// Populated ranges closer than this are combined into one range.
+#define IMAGE_RANGE_GAP       0x100
+// Data bytes in each S record written, as BinToMotorola.
+#define IMAGE_RECORD_SIZE     32
+// Most data bytes in an S3 record which fits a line of 255 characters,
+// the longest line EPP-2_PROG sends.
+#define IMAGE_MAX_RECORD      119
+// Location populated by both images merged, keep the first value, the
+// last, or do not merge if they differ.
+#define IMAGE_OVERLAP_ERROR   0
+#define IMAGE_OVERLAP_FIRST   1
+#define IMAGE_OVERLAP_LAST    2
+
+
+typedef struct
+{
+   unsigned char* Data;
+   unsigned char* Used;
+   unsigned long Start;
+   unsigned long End;
+   unsigned long ByteCount;
+   unsigned long RecordCount;
+   unsigned long CheckSum;
+} ImageType;
+
+
+typedef struct
+{
+   unsigned long Start;
+   unsigned long End;
+} RangeType;
+
+
+typedef struct
+{
+   unsigned long Start;
+   unsigned long End;
+   // Value of the locations after the file, -1 to leave them unpopulated.
+   short Fill;
+   char FileName[IMAGE_LINE_SIZE + 1];
+} AssetType;
+
+
+typedef struct
+{
+   short Count;
+   AssetType* Assets;
+} ManifestType;
+
+
+short ImageCreate(ImageType* Image);
+void ImageFree(ImageType* Image);
+short HexByte(char* Text);
+short ImageReadMotorola(ImageType* Image, FILE* File, char* FileName, unsigned long Offset);
+short ImageLoadMotorola(ImageType* Image, char* FileName, unsigned long Offset);
+short ImageLoadIntel(ImageType* Image, char* FileName, unsigned long Offset);
+short ImageLoadBinary(ImageType* Image, char* FileName, unsigned long Start);
+short ImageLoadFile(ImageType* Image, char* FileName, unsigned long Offset);
+unsigned long ImageCheckSum(ImageType* Image, unsigned long Start, unsigned long End);
+short ImageRecordInfo(char* Record, unsigned long* Address, unsigned short* Length);
+unsigned long ImageCount(ImageType* Image, unsigned long Start, unsigned long End);
+short ImageRanges(ImageType* Image, RangeType* Ranges, short MaxRanges, unsigned long Gap);
+void ImageMotorolaRecord(FILE* File, unsigned long Address, unsigned char* Data, short Length);
+void ImageMotorolaEnd(FILE* File, unsigned long Address);
+void ImageFill(ImageType* Image, unsigned long Start, unsigned long End, unsigned char Value);
+short ImageMerge(ImageType* Image, ImageType* Next, short Policy, unsigned long* Overlaps, unsigned long* Conflicts);
+short ImageWriteMotorola(ImageType* Image, char* FileName, short RecordSize);
+long ImageWriteChanges(ImageType* Image, ImageType* Previous, char* FileName, short RecordSize);
+short ImageReadManifest(ManifestType* Manifest, char* FileName);
+short ImageLoadManifest(ImageType* Image, ManifestType* Manifest);
+void ImageFreeManifest(ManifestType* Manifest);
+
+
+#endif
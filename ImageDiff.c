@@ -0,0 +1,165 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* ImageDiff - Compare two ROM images by address, whatever their format.    */
+/* ------------------------------------------------------------------------ */
+/* Load two Motorola S record, Intel HEX or binary files into the EPROM     */
+/* address space and compare the data at each address. Unlike a text diff   */
+/* of two S record files, the record lengths, address sizes and line ends   */
+/* of the files do not matter. Addresses not populated by a file are taken  */
+/* to be erased. The address ranges which differ are listed, followed by    */
+/* the number of bits which differ at each bit position, so a device with   */
+/* bits which fail to program can be told apart from a wrong image.         */
+/****************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include "Image.h"
+
+
+#define ARG_COUNT             3
+#define ARG_EXE               0
+#define ARG_FILE_A            1
+#define ARG_FILE_B            2
+
+// Equal blocks of this size are skipped with one memcmp().
+#define DIFF_BLOCK_SIZE       0x1000
+
+
+
+/****************************************************/
+/* Display a range of differing addresses, if open. */
+/****************************************************/
+void ShowRange(long* RangeStart, unsigned long End)
+{
+   if (*RangeStart < 0)
+      return;
+   printf("DIFFERENT: %6.6lX - %6.6lX %6lu BYTES\r\n", *RangeStart, End, End - *RangeStart + 1);
+   *RangeStart = -1;
+}
+
+
+
+int main(int argc, char* argv[])
+{
+   short Bit;
+   unsigned char Xor;
+   unsigned long Address;
+   unsigned long Block;
+   unsigned long BlockEnd;
+   unsigned long Start;
+   unsigned long End;
+   unsigned long Bytes = 0;
+   unsigned long Bits = 0;
+   unsigned long BitCount[8][2];
+   unsigned long long WordA;
+   unsigned long long WordB;
+   long RangeStart = -1;
+   ImageType ImageA;
+   ImageType ImageB;
+
+   if (argc != ARG_COUNT)
+   {
+      printf("\n%s [FILE_A] [FILE_B]\n", argv[ARG_EXE]);
+      printf("WHERE:\n");
+      printf("[FILE_A] - Motorola S record, Intel HEX or binary file.\n");
+      printf("[FILE_B] - Motorola S record, Intel HEX or binary file to compare.\n");
+      printf("\n");
+      return 2;
+   }
+   if (!ImageCreate(&ImageA) || !ImageCreate(&ImageB))
+   {
+      printf("Failed to allocate memory for the image\r\n");
+      return 2;
+   }
+   if (!ImageLoadFile(&ImageA, argv[ARG_FILE_A], 0) || !ImageLoadFile(&ImageB, argv[ARG_FILE_B], 0)
+      || (!ImageA.ByteCount && !ImageB.ByteCount))
+   {
+      printf("NO DATA TO COMPARE\r\n");
+      ImageFree(&ImageA);
+      ImageFree(&ImageB);
+      return 2;
+   }
+   printf("FILE A: %6.6lX - %6.6lX %6lu BYTES %s\r\n", ImageA.Start, ImageA.End, ImageA.ByteCount, argv[ARG_FILE_A]);
+   printf("FILE B: %6.6lX - %6.6lX %6lu BYTES %s\r\n\r\n", ImageB.Start, ImageB.End, ImageB.ByteCount, argv[ARG_FILE_B]);
+
+  /************************************************/
+ /* Compare the address range covered by either. */
+/************************************************/
+   Start = (!ImageB.ByteCount || (ImageA.ByteCount && ImageA.Start < ImageB.Start)) ? ImageA.Start : ImageB.Start;
+   End = (!ImageB.ByteCount || (ImageA.ByteCount && ImageA.End > ImageB.End)) ? ImageA.End : ImageB.End;
+   memset(BitCount, 0, sizeof(BitCount));
+   for (Block = Start; Block <= End; Block += DIFF_BLOCK_SIZE)
+   {
+      BlockEnd = (End - Block < DIFF_BLOCK_SIZE) ? End + 1 : Block + DIFF_BLOCK_SIZE;
+      if (!memcmp(&(ImageA.Data[Block]), &(ImageB.Data[Block]), BlockEnd - Block))
+      {
+         ShowRange(&RangeStart, Block - 1);
+         continue;
+      }
+   /****************************************************************/
+  /* Compare eight bytes at a time, only a word which differs is  */
+ /* examined a byte at a time.                                   */
+/****************************************************************/
+      for (Address = Block; Address < BlockEnd; ++Address)
+      {
+         if (!(Address & 7) && Address + 8 <= BlockEnd)
+         {
+            memcpy(&WordA, &(ImageA.Data[Address]), sizeof(WordA));
+            memcpy(&WordB, &(ImageB.Data[Address]), sizeof(WordB));
+            if (WordA == WordB)
+            {
+               ShowRange(&RangeStart, Address - 1);
+               Address += 7;
+               continue;
+            }
+         }
+
+         if (!(Xor = ImageA.Data[Address] ^ ImageB.Data[Address]))
+         {
+            ShowRange(&RangeStart, Address - 1);
+            continue;
+         }
+         ++Bytes;
+         Bits += __builtin_popcount(Xor);
+         if (RangeStart < 0)
+            RangeStart = Address;
+         // Count each differing bit as A = 1, B = 0 or A = 0, B = 1.
+         for (Bit = 0; Bit < 8; ++Bit)
+            if (Xor & (1 << Bit))
+               ++BitCount[Bit][(ImageA.Data[Address] >> Bit) & 1 ? 0 : 1];
+      }
+   }
+   ShowRange(&RangeStart, End);
+
+  /****************************************************/
+ /* Display the totals and the per bit error counts. */
+/****************************************************/
+   printf("\r\nCOMPARED: %6.6lX - %6.6lX %lu BYTES, %lu BYTES DIFFER, %lu BITS DIFFER\r\n", Start, End, End - Start + 1, Bytes, Bits);
+   if (Bytes)
+   {
+      printf("\r\nBIT  A=1 B=0  A=0 B=1\r\n");
+      for (Bit = 7; Bit >= 0; --Bit)
+         printf(" %d   %7lu  %7lu\r\n", Bit, BitCount[Bit][0], BitCount[Bit][1]);
+   }
+
+   ImageFree(&ImageA);
+   ImageFree(&ImageB);
+
+   return Bytes ? 1 : 0;
+}
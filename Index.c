@@ -0,0 +1,262 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* Index - Hashed library of known ROM images, to identify device contents. */
+/* ------------------------------------------------------------------------ */
+/* Each known image is hashed in 1 KB blocks. The hash of every block is    */
+/* chained into a running hash, so the chain at a block is the hash of the  */
+/* image up to that block, and the last chain value is the hash of the      */
+/* whole image. A device can then be matched a block at a time as it is     */
+/* read. All block hashes are held in one hash table, so a block of a       */
+/* device is found in every known image containing it with one lookup.      */
+/*                                                                          */
+/* The index file is text, one line for each image followed by one line     */
+/* for each block of the image:                                             */
+/* I [SIZE] [HASH] [NAME]                                                   */
+/* B [BLOCK_HASH]                                                           */
+/****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Index.h"
+#include "Log.h"
+
+
+
+/*************************************************/
+/* FNV-1a 64 bit hash of Length bytes of data.   */
+/*************************************************/
+IndexHashType IndexHash(unsigned char* Data, unsigned long Length)
+{
+   IndexHashType Hash = INDEX_HASH_BASIS;
+
+   while (Length--)
+      Hash = (Hash ^ *(Data++)) * INDEX_HASH_PRIME;
+
+   return Hash;
+}
+
+
+
+/***************************************************************/
+/* Add the hash of the next block to the running hash, Chain.  */
+/* The chain of the first block starts with INDEX_HASH_BASIS.  */
+/***************************************************************/
+IndexHashType IndexChain(IndexHashType Chain, IndexHashType Block)
+{
+   short Count;
+
+   for (Count = 0; Count < 8; ++Count, Block >>= 8)
+      Chain = (Chain ^ (Block & 0xFF)) * INDEX_HASH_PRIME;
+
+   return Chain;
+}
+
+
+
+/*******************************************************************/
+/* Add a block of an image to the hash table, duplicate hashes are */
+/* held in the following slots.                                    */
+/*******************************************************************/
+static void IndexInsert(IndexType* Index, IndexEntryType* Entry, unsigned long Block)
+{
+   unsigned long Slot;
+
+   for (Slot = Entry->Blocks[Block] & (Index->SlotCount - 1); Index->Slots[Slot].Entry; Slot = (Slot + 1) & (Index->SlotCount - 1));
+   Index->Slots[Slot].Hash = Entry->Blocks[Block];
+   Index->Slots[Slot].Entry = Entry;
+   Index->Slots[Slot].Block = Block;
+}
+
+
+
+/********************************************************************/
+/* Load an index file and build the hash table of the image blocks. */
+/* Returns FALSE if the file could not be read or is invalid.       */
+/********************************************************************/
+short IndexLoad(IndexType* Index, char* FileName)
+{
+   FILE* File;
+   short Result = TRUE;
+   int Length;
+   unsigned long Count;
+   unsigned long Block;
+   unsigned long BlockTotal = 0;
+   IndexHashType Hash;
+   IndexEntryType* Entry = NULL;
+   char Buffer[INDEX_LINE_SIZE + 1];
+
+   memset(Index, 0, sizeof(IndexType));
+   if (!(File = fopen(FileName, "rt")))
+   {
+      LogPrint(LOG_ERROR, "Failed to open index file: %s\r\n", FileName);
+      return FALSE;
+   }
+
+  /*****************************************************/
+ /* Read the images and the block hashes of each one. */
+/*****************************************************/
+   while (Result && fgets(Buffer, INDEX_LINE_SIZE, File))
+   {
+      while (Buffer[0] != '\0' && (Buffer[strlen(Buffer)-1] == '\r' || Buffer[strlen(Buffer)-1] == '\n'))
+         Buffer[strlen(Buffer)-1] = '\0';
+      if (Buffer[0] == 'I')
+      {
+         if (!(Entry = realloc(Index->Entries, (Index->Count + 1) * sizeof(IndexEntryType))))
+         {
+            Result = FALSE;
+            break;
+         }
+         Index->Entries = Entry;
+         Entry = &(Index->Entries[Index->Count++]);
+         memset(Entry, 0, sizeof(IndexEntryType));
+         if (sscanf(Buffer, "I %lX %llX %n", &(Entry->Size), &Hash, &Length) != 2 || !Entry->Size)
+            Result = FALSE;
+         else
+         {
+            strncpy(Entry->Name, &(Buffer[Length]), INDEX_NAME_SIZE);
+            Entry->Blocks = malloc(((Entry->Size + INDEX_BLOCK_SIZE - 1) / INDEX_BLOCK_SIZE) * sizeof(IndexHashType));
+            Entry->Chain = malloc(((Entry->Size + INDEX_BLOCK_SIZE - 1) / INDEX_BLOCK_SIZE) * sizeof(IndexHashType));
+            Result = (Entry->Blocks && Entry->Chain);
+         }
+      }
+      else if (Buffer[0] == 'B')
+      {
+         if (!Entry || Entry->BlockCount * INDEX_BLOCK_SIZE >= Entry->Size || sscanf(Buffer, "B %llX", &Hash) != 1)
+            Result = FALSE;
+         else
+         {
+            Entry->Blocks[Entry->BlockCount] = Hash;
+            Entry->Chain[Entry->BlockCount] = IndexChain(Entry->BlockCount ? Entry->Chain[Entry->BlockCount - 1] : INDEX_HASH_BASIS, Hash);
+            ++Entry->BlockCount;
+            ++BlockTotal;
+         }
+      }
+   };
+   fclose(File);
+   // Every image must have a hash for each of its blocks.
+   for (Count = 0; Result && Count < Index->Count; ++Count)
+      if (Index->Entries[Count].BlockCount * INDEX_BLOCK_SIZE < Index->Entries[Count].Size)
+         Result = FALSE;
+   if (!Result)
+   {
+      LogPrint(LOG_ERROR, "INVALID INDEX FILE: %s\r\n", FileName);
+      IndexFree(Index);
+      return FALSE;
+   }
+
+  /************************************************************/
+ /* Hash table of all blocks, at most half full, size 2^N.   */
+/************************************************************/
+   for (Index->SlotCount = 1; Index->SlotCount < 2 * BlockTotal; Index->SlotCount <<= 1);
+   if (!(Index->Slots = calloc(Index->SlotCount, sizeof(IndexSlotType))))
+   {
+      IndexFree(Index);
+      return FALSE;
+   }
+   for (Count = 0; Count < Index->Count; ++Count)
+      for (Block = 0; Block < Index->Entries[Count].BlockCount; ++Block)
+         IndexInsert(Index, &(Index->Entries[Count]), Block);
+
+   return TRUE;
+}
+
+
+
+void IndexFree(IndexType* Index)
+{
+   unsigned long Count;
+
+   for (Count = 0; Count < Index->Count; ++Count)
+   {
+      free(Index->Entries[Count].Blocks);
+      free(Index->Entries[Count].Chain);
+   }
+   free(Index->Entries);
+   free(Index->Slots);
+   memset(Index, 0, sizeof(IndexType));
+}
+
+
+
+/*****************************************************************/
+/* Find the next image block with the Hash. Position is set to 0 */
+/* for the first lookup of a hash, and is updated by each call.  */
+/* Returns NULL when there are no more blocks with the hash.     */
+/*****************************************************************/
+IndexSlotType* IndexLookup(IndexType* Index, IndexHashType Hash, unsigned long* Position)
+{
+   IndexSlotType* Slot;
+
+   if (!Index->SlotCount)
+      return NULL;
+   while (*Position < Index->SlotCount)
+   {
+      Slot = &(Index->Slots[(Hash + (*Position)++) & (Index->SlotCount - 1)]);
+      if (!Slot->Entry)
+         break;
+      if (Slot->Hash == Hash)
+         return Slot;
+   };
+
+   return NULL;
+}
+
+
+
+/*******************************************************************/
+/* Append an image to an index file. The last block is padded with */
+/* erased locations, as the rest of a larger device would be.      */
+/*******************************************************************/
+short IndexAppend(char* FileName, char* Name, unsigned char* Data, unsigned long Size)
+{
+   FILE* File;
+   unsigned long Block;
+   unsigned long BlockCount;
+   unsigned long Length;
+   IndexHashType* Blocks;
+   IndexHashType Chain = INDEX_HASH_BASIS;
+   unsigned char Buffer[INDEX_BLOCK_SIZE];
+
+   BlockCount = (Size + INDEX_BLOCK_SIZE - 1) / INDEX_BLOCK_SIZE;
+   if (!Size || !(Blocks = malloc(BlockCount * sizeof(IndexHashType))))
+      return FALSE;
+   if (!(File = fopen(FileName, "at")))
+   {
+      LogPrint(LOG_ERROR, "Failed to open index file for writing: %s\r\n", FileName);
+      free(Blocks);
+      return FALSE;
+   }
+
+   for (Block = 0; Block < BlockCount; ++Block)
+   {
+      Length = (Size - Block * INDEX_BLOCK_SIZE < INDEX_BLOCK_SIZE) ? Size - Block * INDEX_BLOCK_SIZE : INDEX_BLOCK_SIZE;
+      memset(Buffer, 0xFF, INDEX_BLOCK_SIZE);
+      memcpy(Buffer, &(Data[Block * INDEX_BLOCK_SIZE]), Length);
+      Blocks[Block] = IndexHash(Buffer, INDEX_BLOCK_SIZE);
+      Chain = IndexChain(Chain, Blocks[Block]);
+   }
+   fprintf(File, "I %8.8lX %16.16llX %s\n", Size, Chain, Name);
+   for (Block = 0; Block < BlockCount; ++Block)
+      fprintf(File, "B %16.16llX\n", Blocks[Block]);
+   fclose(File);
+   free(Blocks);
+
+   return TRUE;
+}
@@ -0,0 +1,77 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef __INDEX_H
+#define __INDEX_H
+
+
+#ifndef FALSE
+#define FALSE                 0
+#endif
+#ifndef TRUE
+#define TRUE                  1
+#endif
+
+// Images are hashed in blocks of this size, the smallest EPP-2 device.
+#define INDEX_BLOCK_SIZE      0x400
+#define INDEX_NAME_SIZE       255
+#define INDEX_LINE_SIZE       511
+// FNV-1a 64 bit hash parameters.
+#define INDEX_HASH_BASIS      0xCBF29CE484222325ULL
+#define INDEX_HASH_PRIME      0x100000001B3ULL
+
+
+typedef unsigned long long IndexHashType;
+
+
+typedef struct
+{
+   char Name[INDEX_NAME_SIZE + 1];
+   unsigned long Size;
+   unsigned long BlockCount;
+   // Hash of each block, and the hash of all blocks up to each block.
+   IndexHashType* Blocks;
+   IndexHashType* Chain;
+} IndexEntryType;
+
+
+typedef struct
+{
+   IndexHashType Hash;
+   IndexEntryType* Entry;
+   unsigned long Block;
+} IndexSlotType;
+
+
+typedef struct
+{
+   unsigned long Count;
+   IndexEntryType* Entries;
+   unsigned long SlotCount;
+   IndexSlotType* Slots;
+} IndexType;
+
+
+IndexHashType IndexHash(unsigned char* Data, unsigned long Length);
+IndexHashType IndexChain(IndexHashType Chain, IndexHashType Block);
+short IndexLoad(IndexType* Index, char* FileName);
+void IndexFree(IndexType* Index);
+IndexSlotType* IndexLookup(IndexType* Index, IndexHashType Hash, unsigned long* Position);
+short IndexAppend(char* FileName, char* Name, unsigned char* Data, unsigned long Size);
+
+
+#endif
@@ -0,0 +1,318 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* Log - Messages and serial traffic, by verbosity level.                   */
+/* ------------------------------------------------------------------------ */
+/* A message above LogLevel is discarded before it is formatted, so a quiet */
+/* session spends no time on the echo of the S records. Once LogStart() is  */
+/* called, messages are copied into a queue of fixed slots and written to   */
+/* the stream by a thread of their own, collected into large writes, so a   */
+/* slow terminal does not hold up the serial port. The queue is lock free,  */
+/* any thread reserves a slot by advancing the head with compare and swap,  */
+/* and marks it full with the slot sequence number. When the queue is full  */
+/* traffic is dropped and counted, other messages wait for a free slot.     */
+/* Before LogStart(), and after LogStop(), messages are written directly.   */
+/****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "Log.h"
+
+
+typedef struct
+{
+   // Position of the slot when free, position + 1 when it holds a message.
+   atomic_ulong Sequence;
+   short Length;
+   char Text[LOG_SLOT_SIZE];
+} LogSlotType;
+
+
+short LogLevel = LOG_TRAFFIC;
+
+static char* LogLevels[] =
+{
+   "QUIET", "ERROR", "INFO", "TRAFFIC", NULL,
+};
+
+static FILE* LogStream;
+static pthread_t LogThread;
+static atomic_int LogRunning;
+static atomic_int LogStarted;
+static atomic_ulong LogHead;
+static atomic_ulong LogTail;
+// Position of the queue written to the stream, and messages dropped.
+static atomic_ulong LogWritten;
+static atomic_ulong LogDropped;
+static LogSlotType LogSlots[LOG_SLOTS];
+static char LogBuffer[LOG_WRITE_SIZE];
+
+
+
+/**************************************************************/
+/* Level of a LOG_LEVEL configuration value, -1 if invalid.   */
+/**************************************************************/
+short LogLevelName(char* Name)
+{
+   short Level;
+
+   for (Level = 0; LogLevels[Level]; ++Level)
+      if (!strcmp(Name, LogLevels[Level]))
+         return Level;
+
+   return -1;
+}
+
+
+
+/*****************************************************************/
+/* Write the queued messages to the stream, until LogStop().     */
+/* Messages are collected into one write while the queue holds   */
+/* any, the stream is written and flushed when it is empty.      */
+/*****************************************************************/
+static void* LogWriter(void* Context)
+{
+   size_t Length = 0;
+   unsigned long Tail;
+   unsigned long Dropped;
+   LogSlotType* Slot;
+   struct timespec Sleep = { 0, LOG_IDLE_TIME * 1000 };
+
+   for (;;)
+   {
+      Tail = atomic_load(&LogTail);
+      Slot = &(LogSlots[Tail & (LOG_SLOTS - 1)]);
+      if (atomic_load_explicit(&(Slot->Sequence), memory_order_acquire) == Tail + 1)
+      {
+         if (Length + Slot->Length > LOG_WRITE_SIZE)
+         {
+            fwrite(LogBuffer, 1, Length, LogStream);
+            Length = 0;
+         }
+         memcpy(&(LogBuffer[Length]), Slot->Text, Slot->Length);
+         Length += Slot->Length;
+         atomic_store_explicit(&(Slot->Sequence), Tail + LOG_SLOTS, memory_order_release);
+         atomic_store(&LogTail, Tail + 1);
+         continue;
+      }
+
+      if (Length)
+         fwrite(LogBuffer, 1, Length, LogStream);
+      Length = 0;
+      if ((Dropped = atomic_exchange(&LogDropped, 0)))
+         fprintf(LogStream, "\r\nLOG: %lu MESSAGES DROPPED\r\n", Dropped);
+      fflush(LogStream);
+      atomic_store(&LogWritten, Tail);
+      if (!atomic_load(&LogRunning))
+         break;
+      nanosleep(&Sleep, NULL);
+   };
+
+   return NULL;
+}
+
+
+
+/**************************************************************/
+/* Write the messages which follow to Stream from a thread.   */
+/**************************************************************/
+short LogStart(FILE* Stream)
+{
+   unsigned long Position;
+
+   if (atomic_load(&LogStarted))
+      return TRUE;
+   for (Position = 0; Position < LOG_SLOTS; ++Position)
+      atomic_store(&(LogSlots[Position].Sequence), Position);
+   atomic_store(&LogHead, 0);
+   atomic_store(&LogTail, 0);
+   atomic_store(&LogWritten, 0);
+   atomic_store(&LogDropped, 0);
+   LogStream = Stream;
+   atomic_store(&LogRunning, TRUE);
+   if (pthread_create(&LogThread, NULL, LogWriter, NULL))
+      return FALSE;
+   atomic_store(&LogStarted, TRUE);
+
+   return TRUE;
+}
+
+
+
+/*****************************************************************/
+/* Write the queued messages and end the writer thread, later    */
+/* messages are written directly.                                */
+/*****************************************************************/
+void LogStop(void)
+{
+   if (!atomic_load(&LogStarted))
+      return;
+   LogFlush();
+   atomic_store(&LogStarted, FALSE);
+   atomic_store(&LogRunning, FALSE);
+   pthread_join(LogThread, NULL);
+}
+
+
+
+/*****************************************************************/
+/* Wait until the messages queued so far are on the stream, as   */
+/* before waiting for the user or writing the stream directly.   */
+/*****************************************************************/
+void LogFlush(void)
+{
+   unsigned long Head;
+   struct timespec Sleep = { 0, LOG_IDLE_TIME * 1000 };
+
+   if (!atomic_load(&LogStarted))
+      return;
+   Head = atomic_load(&LogHead);
+   while ((long)(atomic_load(&LogWritten) - Head) < 0)
+      nanosleep(&Sleep, NULL);
+}
+
+
+
+/*****************************************************************/
+/* Reserve the next free slot of the queue. When the queue is    */
+/* full, traffic is dropped and NULL returned, other messages    */
+/* wait for the writer to free a slot.                           */
+/*****************************************************************/
+static LogSlotType* LogReserve(short Level, unsigned long* Position)
+{
+   long Difference;
+   LogSlotType* Slot;
+   struct timespec Sleep = { 0, LOG_IDLE_TIME * 1000 };
+
+   *Position = atomic_load(&LogHead);
+   for (;;)
+   {
+      Slot = &(LogSlots[*Position & (LOG_SLOTS - 1)]);
+      Difference = (long)(atomic_load_explicit(&(Slot->Sequence), memory_order_acquire) - *Position);
+      if (!Difference && atomic_compare_exchange_weak(&LogHead, Position, *Position + 1))
+         return Slot;
+      if (Difference < 0)
+      {
+         if (Level >= LOG_TRAFFIC)
+         {
+            atomic_fetch_add(&LogDropped, 1);
+            return NULL;
+         }
+         nanosleep(&Sleep, NULL);
+      }
+      if (Difference)
+         *Position = atomic_load(&LogHead);
+   };
+}
+
+
+
+static void LogCommit(LogSlotType* Slot, unsigned long Position, short Length)
+{
+   Slot->Length = Length;
+   atomic_store_explicit(&(Slot->Sequence), Position + 1, memory_order_release);
+}
+
+
+
+/*****************************************************************/
+/* Queue Length bytes, over as many slots as they need. ESC is   */
+/* shown as '~', the data itself is not modified.                */
+/*****************************************************************/
+static void LogQueue(short Level, char* Data, int Length)
+{
+   int Count = 0;
+   short Used;
+   unsigned long Position;
+   LogSlotType* Slot;
+
+   while (Count < Length && (Slot = LogReserve(Level, &Position)))
+   {
+      for (Used = 0; Used < LOG_SLOT_SIZE && Count < Length; ++Used, ++Count)
+         Slot->Text[Used] = (Data[Count] == 0x1B) ? '~' : Data[Count];
+      LogCommit(Slot, Position, Used);
+   };
+}
+
+
+
+/*******************************************************/
+/* Display a message of a level, if LogLevel allows.   */
+/*******************************************************/
+void LogPrintList(short Level, char* Format, va_list Args)
+{
+   int Length;
+   char Buffer[LOG_LINE_SIZE];
+
+   if (Level > LogLevel)
+      return;
+   if (!atomic_load(&LogStarted))
+      vfprintf(stderr, Format, Args);
+   else if ((Length = vsnprintf(Buffer, LOG_LINE_SIZE, Format, Args)) > 0)
+      LogQueue(Level, Buffer, (Length < LOG_LINE_SIZE) ? Length : LOG_LINE_SIZE - 1);
+}
+
+
+
+void LogPrint(short Level, char* Format, ...)
+{
+   va_list Args;
+
+   va_start(Args, Format);
+   LogPrintList(Level, Format, Args);
+   va_end(Args);
+}
+
+
+
+/*******************************************************************/
+/* Display Length bytes of serial data without formatting them,    */
+/* ESC shown as '~'. With a Prefix the data is shown as one line.  */
+/*******************************************************************/
+void LogData(short Level, char Prefix, char* Data, int Length)
+{
+   char* Escape;
+   char* Text;
+
+   if (Level > LogLevel)
+      return;
+   if (atomic_load(&LogStarted))
+   {
+      if (Prefix)
+         LogQueue(Level, &Prefix, 1);
+      LogQueue(Level, Data, Length);
+      if (Prefix)
+         LogQueue(Level, "\n", 1);
+      return;
+   }
+
+   if (Prefix)
+      fputc(Prefix, stderr);
+   for (Text = Data; (Escape = memchr(Text, 0x1B, Length - (Text - Data))); Text = Escape + 1)
+   {
+      fwrite(Text, 1, Escape - Text, stderr);
+      fputc('~', stderr);
+   }
+   fwrite(Text, 1, Length - (Text - Data), stderr);
+   if (Prefix)
+      fputc('\n', stderr);
+}
@@ -0,0 +1,61 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef __LOG_H
+#define __LOG_H
+
+
+#include <stdio.h>
+#include <stdarg.h>
+
+
+#ifndef FALSE
+#define FALSE                 0
+#endif
+#ifndef TRUE
+#define TRUE                  1
+#endif
+
+// Verbosity levels, a message is displayed if its level is at most LogLevel.
+#define LOG_QUIET             0
+#define LOG_ERROR             1
+#define LOG_INFO              2
+#define LOG_TRAFFIC           3
+// Slots of the queue to the writer thread, a power of 2, and bytes of each.
+#define LOG_SLOTS             4096
+#define LOG_SLOT_SIZE         256
+// Longest formatted message, longer messages are truncated.
+#define LOG_LINE_SIZE         1024
+// Bytes the writer collects before each write to the stream.
+#define LOG_WRITE_SIZE        0x10000
+// Time the writer sleeps when the queue is empty, us.
+#define LOG_IDLE_TIME         2000
+
+
+extern short LogLevel;
+
+
+short LogLevelName(char* Name);
+short LogStart(FILE* Stream);
+void LogStop(void);
+void LogFlush(void);
+void LogPrintList(short Level, char* Format, va_list Args);
+void LogPrint(short Level, char* Format, ...);
+void LogData(short Level, char Prefix, char* Data, int Length);
+
+
+#endif
@@ -0,0 +1,129 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* MergeMotorola - Merge S record & Intel HEX files into full records.      */
+/* ------------------------------------------------------------------------ */
+/* Files from assemblers and other tools often hold short records, records  */
+/* out of address order, or records which overlap. EPP-2_PROG sends a file  */
+/* as it is, one record at a time, with a reply for each record. The files  */
+/* are loaded into one image in memory, locations given by more than one    */
+/* file are resolved by the overlap policy, then the image is written in    */
+/* address order as records of 119 bytes, the longest EPP-2_PROG sends, so  */
+/* a record only ends early at a gap in the data.                           */
+/****************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include "Image.h"
+
+
+#define ARG_COUNT             4
+#define ARG_EXE               0
+#define ARG_POLICY            1
+#define ARG_OUT_FILE          2
+#define ARG_FILE              3
+
+
+
+/******************************************************************/
+/* Records needed for the populated locations of the image, with  */
+/* up to RecordSize bytes in each, as ImageWriteMotorola writes.  */
+/******************************************************************/
+unsigned long MergeRecords(ImageType* Image, short RecordSize)
+{
+   short Length = 0;
+   unsigned long Address;
+   unsigned long Records = 0;
+
+   for (Address = Image->Start; Image->ByteCount && Address <= Image->End; ++Address)
+   {
+      if (!Image->Used[Address])
+         Length = 0;
+      else if (!Length++)
+         ++Records;
+      else if (Length == RecordSize)
+         Length = 0;
+   }
+
+   return Records;
+}
+
+
+
+int main(int argc, char* argv[])
+{
+   short Policy;
+   short Result = TRUE;
+   int Count;
+   unsigned long Overlaps;
+   unsigned long Conflicts;
+   unsigned long TotalOverlaps = 0;
+   ImageType Image;
+   ImageType Next;
+
+   if (argc < ARG_COUNT || !strchr("EFL", argv[ARG_POLICY][0]) || argv[ARG_POLICY][1])
+   {
+      printf("\n%s [E|F|L] [OUT_FILE] [FILE] <FILE> ...\n", argv[ARG_EXE]);
+      printf("WHERE:\n");
+      printf("[E|F|L]    - Data given by more than one file, E error if it differs, F first file wins, L last file wins.\n");
+      printf("[OUT_FILE] - Motorola S record file to write.\n");
+      printf("[FILE]     - Motorola S record or Intel HEX file to merge.\n");
+      printf("\n");
+      return 1;
+   }
+   Policy = (argv[ARG_POLICY][0] == 'E') ? IMAGE_OVERLAP_ERROR : (argv[ARG_POLICY][0] == 'F') ? IMAGE_OVERLAP_FIRST : IMAGE_OVERLAP_LAST;
+   if (!ImageCreate(&Image) || !ImageCreate(&Next))
+   {
+      printf("Failed to allocate memory for the image\r\n");
+      ImageFree(&Image);
+      return 1;
+   }
+
+  /***************************************************************/
+ /* Merge each file in turn, files later in the list are Next.  */
+/***************************************************************/
+   for (Count = ARG_FILE; Result && Count < argc; ++Count)
+   {
+      ImageFree(&Next);
+      if (!ImageCreate(&Next) || !ImageLoadFile(&Next, argv[Count], 0))
+      {
+         printf("FAILED TO LOAD FILE: %s\r\n", argv[Count]);
+         Result = FALSE;
+      }
+      else if (!(Result = ImageMerge(&Image, &Next, Policy, &Overlaps, &Conflicts)))
+         printf("%lu LOCATIONS DIFFER, NO FILE WRITTEN: %s\r\n", Conflicts, argv[Count]);
+      else
+      {
+         printf("%-24s %6lu RECORDS %8lu BYTES %6.6lX - %6.6lX", argv[Count], Next.RecordCount, Next.ByteCount, Next.Start, Next.End);
+         if (Overlaps)
+            printf(", %lu OVERLAP, %lu DIFFER", Overlaps, Conflicts);
+         printf("\r\n");
+         TotalOverlaps += Overlaps;
+      }
+   }
+
+   if (Result && !ImageWriteMotorola(&Image, argv[ARG_OUT_FILE], IMAGE_MAX_RECORD))
+      Result = FALSE;
+   else if (Result)
+      printf("%-24s %6lu RECORDS %8lu BYTES %6.6lX - %6.6lX, FROM %lu RECORDS, %lu OVERLAPPING BYTES\r\n", argv[ARG_OUT_FILE],
+         MergeRecords(&Image, IMAGE_MAX_RECORD), Image.ByteCount, Image.Start, Image.End, Image.RecordCount, TotalOverlaps);
+   ImageFree(&Image);
+   ImageFree(&Next);
+
+   return Result ? 0 : 1;
+}
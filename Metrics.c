@@ -0,0 +1,549 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* Metrics - Counters and histograms of each EPP-2, for monitoring.         */
+/* ------------------------------------------------------------------------ */
+/* Each serial port has counters of the bytes sent and received, records    */
+/* retried, verify failures and EPP-2 error codes, histograms of the time   */
+/* to find the prompt and of the command latency, and for each operation    */
+/* the results, bytes, time taken and throughput. The metrics are written   */
+/* in the Prometheus text format by a thread of their own, to a file at     */
+/* most once a second while they change, and to each client connecting to   */
+/* a Unix socket, with an HTTP header when the client sends a GET request.  */
+/* The file is written to a temporary file and renamed, so it is never      */
+/* read part written. Without a file or socket nothing is measured.         */
+/****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "Metrics.h"
+#include "Log.h"
+
+
+// Upper bound of each bucket of each histogram.
+static double MetricsBounds[][METRICS_BUCKETS] =
+{
+   // Handshake, seconds.
+   { 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1, 2, 5, 10 },
+   // Command latency, seconds.
+   { 0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1 },
+   // Operation time, seconds.
+   { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000 },
+   // Operation throughput, bytes per second.
+   { 50, 100, 200, 300, 500, 700, 1000, 1500, 2000, 5000 },
+};
+
+static pthread_mutex_t MetricsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t MetricsThread;
+static short MetricsStarted = FALSE;
+static short MetricsRunning;
+// Incremented by every change, so an unchanged file is not written again.
+static unsigned long MetricsVersion;
+static char MetricsFile[METRICS_PORT_SIZE + 1];
+static char MetricsSocketName[METRICS_PORT_SIZE + 1];
+static int MetricsSocket = -1;
+// Written by MetricsStop() to wake the thread.
+static int MetricsWake[2] = { -1, -1 };
+static short MetricsPortCount;
+static MetricsPortType MetricsPorts[METRICS_MAX_PORTS];
+static char MetricsBuffer[METRICS_TEXT_SIZE];
+
+
+
+/*******************************************************/
+/* Time of a monotonic clock in ms, for the intervals. */
+/*******************************************************/
+static double MetricsClock(void)
+{
+   struct timespec Now;
+
+   clock_gettime(CLOCK_MONOTONIC, &Now);
+
+   return Now.tv_sec * 1000.0 + Now.tv_nsec / 1e6;
+}
+
+
+
+/****************************************************************/
+/* Write the metrics to the file, through a temporary file      */
+/* renamed over it, so a reader never sees part of the metrics. */
+/****************************************************************/
+static void MetricsWrite(void)
+{
+   FILE* File;
+   int Length;
+   char FileName[METRICS_PORT_SIZE + 8];
+
+   Length = MetricsText(MetricsBuffer, METRICS_TEXT_SIZE);
+   snprintf(FileName, sizeof(FileName), "%s.tmp", MetricsFile);
+   if (!(File = fopen(FileName, "wt")))
+      return;
+   if (fwrite(MetricsBuffer, 1, Length, File) != Length || fclose(File))
+      remove(FileName);
+   else
+      rename(FileName, MetricsFile);
+}
+
+
+
+/*******************************************************************/
+/* Reply to a client of the socket with the metrics. The request   */
+/* is read if one is sent promptly, an HTTP GET request is given   */
+/* an HTTP reply, so the socket can be scraped as well as read. A  */
+/* client which disconnects or stops reading for METRICS_SEND_TIME */
+/* ms is dropped without a SIGPIPE.                                */
+/*******************************************************************/
+static void MetricsReply(void)
+{
+   int Client;
+   int Length;
+   int Sent;
+   int Bytes = 0;
+   char Request[METRICS_PORT_SIZE + 1];
+   char Header[METRICS_PORT_SIZE + 1];
+   struct pollfd Poll;
+   struct timeval TimeOut = { METRICS_SEND_TIME / 1000, (METRICS_SEND_TIME % 1000) * 1000 };
+
+   if ((Client = accept(MetricsSocket, NULL, NULL)) < 0)
+      return;
+   setsockopt(Client, SOL_SOCKET, SO_SNDTIMEO, &TimeOut, sizeof(TimeOut));
+   Poll.fd = Client;
+   Poll.events = POLLIN;
+   if (poll(&Poll, 1, 100) > 0 && (Bytes = read(Client, Request, METRICS_PORT_SIZE)) < 0)
+      Bytes = 0;
+   Request[Bytes] = '\0';
+   Length = MetricsText(MetricsBuffer, METRICS_TEXT_SIZE);
+   if (!strncmp(Request, "GET ", 4))
+   {
+      Bytes = snprintf(Header, METRICS_PORT_SIZE, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %d\r\n\r\n", Length);
+      if (send(Client, Header, Bytes, MSG_NOSIGNAL) != Bytes)
+         Length = 0;
+   }
+   for (Sent = 0; Sent < Length && (Bytes = send(Client, &(MetricsBuffer[Sent]), Length - Sent, MSG_NOSIGNAL)) > 0; Sent += Bytes);
+   close(Client);
+}
+
+
+
+/******************************************************************/
+/* Serve the socket and write the file until MetricsStop(). The   */
+/* file is written at most once an interval while the metrics     */
+/* change, and once more when stopped.                            */
+/******************************************************************/
+static void* MetricsServe(void* Context)
+{
+   short Running = TRUE;
+   unsigned long Version;
+   unsigned long Written = 0;
+   double LastWrite = 0;
+   struct pollfd Poll[2];
+
+   Poll[0].fd = MetricsWake[0];
+   Poll[0].events = POLLIN;
+   Poll[1].fd = MetricsSocket;
+   Poll[1].events = POLLIN;
+   while (Running)
+   {
+      Poll[1].revents = 0;
+      poll(Poll, (MetricsSocket < 0) ? 1 : 2, METRICS_INTERVAL);
+      if (Poll[1].revents & POLLIN)
+         MetricsReply();
+      pthread_mutex_lock(&MetricsLock);
+      Running = MetricsRunning;
+      Version = MetricsVersion;
+      pthread_mutex_unlock(&MetricsLock);
+      if (MetricsFile[0] && Version != Written && (!Running || MetricsClock() - LastWrite >= METRICS_INTERVAL))
+      {
+         MetricsWrite();
+         Written = Version;
+         LastWrite = MetricsClock();
+      }
+   };
+
+   return NULL;
+}
+
+
+
+/*******************************************************************/
+/* Start measuring, writing the metrics to FileName and serving    */
+/* them on the Unix socket SocketName, either may be empty. When   */
+/* both are empty nothing is measured. Returns FALSE on failure.   */
+/*******************************************************************/
+short MetricsStart(char* FileName, char* SocketName)
+{
+   struct sockaddr_un Address;
+
+   if (MetricsStarted || (!FileName[0] && !SocketName[0]))
+      return TRUE;
+   snprintf(MetricsFile, METRICS_PORT_SIZE + 1, "%s", FileName);
+   snprintf(MetricsSocketName, METRICS_PORT_SIZE + 1, "%s", SocketName);
+   memset(MetricsPorts, 0, sizeof(MetricsPorts));
+   MetricsPortCount = 0;
+   MetricsVersion = 1;
+   if (SocketName[0])
+   {
+      memset(&Address, 0, sizeof(Address));
+      Address.sun_family = AF_UNIX;
+      snprintf(Address.sun_path, sizeof(Address.sun_path), "%s", SocketName);
+      // A socket left by an earlier run is replaced.
+      unlink(SocketName);
+      if ((MetricsSocket = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+         || bind(MetricsSocket, (struct sockaddr*)&Address, sizeof(Address)) || listen(MetricsSocket, 4))
+      {
+         LogPrint(LOG_ERROR, "Failed to open metrics socket: %s\r\n", SocketName);
+         if (MetricsSocket >= 0)
+            close(MetricsSocket);
+         MetricsSocket = -1;
+         MetricsSocketName[0] = '\0';
+      }
+   }
+   if (pipe(MetricsWake))
+      return FALSE;
+   MetricsRunning = TRUE;
+   if (pthread_create(&MetricsThread, NULL, MetricsServe, NULL))
+   {
+      close(MetricsWake[0]);
+      close(MetricsWake[1]);
+      return FALSE;
+   }
+   MetricsStarted = TRUE;
+
+   return TRUE;
+}
+
+
+
+/*****************************************************************/
+/* Write the final metrics to the file and close the socket.     */
+/*****************************************************************/
+void MetricsStop(void)
+{
+   if (!MetricsStarted)
+      return;
+   pthread_mutex_lock(&MetricsLock);
+   MetricsRunning = FALSE;
+   pthread_mutex_unlock(&MetricsLock);
+   write(MetricsWake[1], "", 1);
+   pthread_join(MetricsThread, NULL);
+   close(MetricsWake[0]);
+   close(MetricsWake[1]);
+   if (MetricsSocket >= 0)
+   {
+      close(MetricsSocket);
+      unlink(MetricsSocketName);
+      MetricsSocket = -1;
+   }
+   MetricsStarted = FALSE;
+}
+
+
+
+/****************************************************************/
+/* Metrics of a serial port, added on first use. Returns NULL   */
+/* when not measuring, which every Metrics function ignores.    */
+/****************************************************************/
+MetricsPortType* MetricsPort(char* Port)
+{
+   short Count;
+   MetricsPortType* Result = NULL;
+
+   if (!MetricsStarted)
+      return NULL;
+   pthread_mutex_lock(&MetricsLock);
+   for (Count = 0; Count < MetricsPortCount && strcmp(MetricsPorts[Count].Port, Port); ++Count);
+   if (Count < MetricsPortCount)
+      Result = &(MetricsPorts[Count]);
+   else if (MetricsPortCount < METRICS_MAX_PORTS)
+   {
+      Result = &(MetricsPorts[MetricsPortCount++]);
+      snprintf(Result->Port, METRICS_PORT_SIZE + 1, "%s", Port);
+   }
+   pthread_mutex_unlock(&MetricsLock);
+
+   return Result;
+}
+
+
+
+void MetricsCount(MetricsPortType* Port, short Counter, unsigned long Value)
+{
+   if (!Port)
+      return;
+   pthread_mutex_lock(&MetricsLock);
+   Port->Counters[Counter] += Value;
+   ++MetricsVersion;
+   pthread_mutex_unlock(&MetricsLock);
+}
+
+
+
+static void MetricsAdd(MetricsHistogramType* Histogram, short Bounds, double Value)
+{
+   short Bucket;
+
+   for (Bucket = 0; Bucket < METRICS_BUCKETS && Value > MetricsBounds[Bounds][Bucket]; ++Bucket);
+   if (Bucket < METRICS_BUCKETS)
+      ++Histogram->Buckets[Bucket];
+   ++Histogram->Count;
+   Histogram->Sum += Value;
+}
+
+
+
+/*******************************************************************/
+/* Add a value to the METRICS_HANDSHAKE or METRICS_LATENCY         */
+/* histogram of the port.                                          */
+/*******************************************************************/
+void MetricsObserve(MetricsPortType* Port, short Histogram, double Value)
+{
+   if (!Port)
+      return;
+   pthread_mutex_lock(&MetricsLock);
+   MetricsAdd((Histogram == METRICS_HANDSHAKE) ? &(Port->Handshake) : &(Port->Latency), Histogram, Value);
+   ++MetricsVersion;
+   pthread_mutex_unlock(&MetricsLock);
+}
+
+
+
+/***************************************************************/
+/* Count an error code of the G command, 0 without an error.   */
+/* Codes after the first METRICS_MAX_CODES are not counted.    */
+/***************************************************************/
+void MetricsStatus(MetricsPortType* Port, unsigned long Code)
+{
+   short Count;
+
+   if (!Port)
+      return;
+   pthread_mutex_lock(&MetricsLock);
+   for (Count = 0; Count < Port->CodeCount && Port->Codes[Count] != Code; ++Count);
+   if (Count == Port->CodeCount && Count < METRICS_MAX_CODES)
+      Port->Codes[Port->CodeCount++] = Code;
+   if (Count < Port->CodeCount)
+      ++Port->CodeCounts[Count];
+   ++MetricsVersion;
+   pthread_mutex_unlock(&MetricsLock);
+}
+
+
+
+/*******************************************************/
+/* Mark an operation as in progress on the port.       */
+/*******************************************************/
+void MetricsBegin(MetricsPortType* Port, char Operation)
+{
+   if (!Port)
+      return;
+   pthread_mutex_lock(&MetricsLock);
+   Port->Operation = Operation;
+   ++MetricsVersion;
+   pthread_mutex_unlock(&MetricsLock);
+}
+
+
+
+/*****************************************************************/
+/* Count the end of an operation, its bytes and time, and the    */
+/* throughput of an operation which passed. A V or C operation   */
+/* which failed is also counted as a verify failure.             */
+/*****************************************************************/
+void MetricsOperation(MetricsPortType* Port, char Operation, short Passed, unsigned long Bytes, double Seconds)
+{
+   char* Found;
+   MetricsOperationType* Measured;
+
+   if (!Port)
+      return;
+   pthread_mutex_lock(&MetricsLock);
+   Port->Operation = 0;
+   if (Operation && (Found = strchr(METRICS_OPERATIONS, Operation)))
+   {
+      Measured = &(Port->Operations[Found - METRICS_OPERATIONS]);
+      if (Passed)
+         ++Measured->Passed;
+      else
+         ++Measured->Failed;
+      Measured->Bytes += Bytes;
+      MetricsAdd(&(Measured->Seconds), METRICS_SECONDS, Seconds);
+      if (Passed && Bytes && Seconds > 0)
+         MetricsAdd(&(Measured->Throughput), METRICS_THROUGHPUT, Bytes / Seconds);
+      if (!Passed && (Operation == 'V' || Operation == 'C'))
+         ++Port->Counters[METRICS_VERIFY_FAILED];
+   }
+   ++MetricsVersion;
+   pthread_mutex_unlock(&MetricsLock);
+}
+
+
+
+/***************************************************************/
+/* Append formatted text, ignoring what does not fit the Size. */
+/***************************************************************/
+static int MetricsPrint(char* Text, int Size, int Length, char* Format, ...)
+{
+   int Bytes;
+   va_list Args;
+
+   if (Length >= Size - 1)
+      return Length;
+   va_start(Args, Format);
+   Bytes = vsnprintf(&(Text[Length]), Size - Length, Format, Args);
+   va_end(Args);
+
+   return (Bytes < 0 || Length + Bytes >= Size) ? Length : Length + Bytes;
+}
+
+
+
+/*********************************************************************/
+/* Append the buckets, sum and count of a histogram, the Prometheus  */
+/* buckets count every value up to their bound.                      */
+/*********************************************************************/
+static int MetricsHistogram(char* Text, int Size, int Length, char* Name, char* Labels, MetricsHistogramType* Histogram, short Bounds)
+{
+   short Bucket;
+   unsigned long Count = 0;
+
+   for (Bucket = 0; Bucket < METRICS_BUCKETS; ++Bucket)
+   {
+      Count += Histogram->Buckets[Bucket];
+      Length = MetricsPrint(Text, Size, Length, "%s_bucket{%s,le=\"%g\"} %lu\n", Name, Labels, MetricsBounds[Bounds][Bucket], Count);
+   }
+   Length = MetricsPrint(Text, Size, Length, "%s_bucket{%s,le=\"+Inf\"} %lu\n", Name, Labels, Histogram->Count);
+   Length = MetricsPrint(Text, Size, Length, "%s_sum{%s} %g\n", Name, Labels, Histogram->Sum);
+
+   return MetricsPrint(Text, Size, Length, "%s_count{%s} %lu\n", Name, Labels, Histogram->Count);
+}
+
+
+
+static int MetricsFamily(char* Text, int Size, int Length, char* Name, char* Type, char* Help)
+{
+   Length = MetricsPrint(Text, Size, Length, "# HELP %s %s\n", Name, Help);
+
+   return MetricsPrint(Text, Size, Length, "# TYPE %s %s\n", Name, Type);
+}
+
+
+
+/*********************************************************************/
+/* Format the metrics of every port in the Prometheus text format,   */
+/* up to Size bytes. Returns the length of the text.                 */
+/*********************************************************************/
+int MetricsText(char* Text, int Size)
+{
+   short Count;
+   short Index;
+   short Code;
+   int Length = 0;
+   char Labels[2 * METRICS_PORT_SIZE + 1];
+   MetricsPortType* Port;
+   MetricsOperationType* Measured;
+
+   Text[0] = '\0';
+   pthread_mutex_lock(&MetricsLock);
+   Length = MetricsFamily(Text, Size, Length, "epp2_serial_bytes_total", "counter", "Bytes sent to and received from the EPP-2.");
+   for (Count = 0; Count < MetricsPortCount; ++Count)
+   {
+      Port = &(MetricsPorts[Count]);
+      Length = MetricsPrint(Text, Size, Length, "epp2_serial_bytes_total{port=\"%s\",direction=\"sent\"} %lu\n", Port->Port, Port->Counters[METRICS_SENT]);
+      Length = MetricsPrint(Text, Size, Length, "epp2_serial_bytes_total{port=\"%s\",direction=\"received\"} %lu\n", Port->Port, Port->Counters[METRICS_RECEIVED]);
+   }
+   Length = MetricsFamily(Text, Size, Length, "epp2_retries_total", "counter", "Records sent again after a communication error.");
+   for (Count = 0; Count < MetricsPortCount; ++Count)
+      Length = MetricsPrint(Text, Size, Length, "epp2_retries_total{port=\"%s\"} %lu\n", MetricsPorts[Count].Port, MetricsPorts[Count].Counters[METRICS_RETRIES]);
+   Length = MetricsFamily(Text, Size, Length, "epp2_verify_failures_total", "counter", "V and C operations which found the device differs.");
+   for (Count = 0; Count < MetricsPortCount; ++Count)
+      Length = MetricsPrint(Text, Size, Length, "epp2_verify_failures_total{port=\"%s\"} %lu\n", MetricsPorts[Count].Port, MetricsPorts[Count].Counters[METRICS_VERIFY_FAILED]);
+   Length = MetricsFamily(Text, Size, Length, "epp2_status_total", "counter", "EPP-2 status replies by error code, 0000 without an error.");
+   for (Count = 0; Count < MetricsPortCount; ++Count)
+      for (Code = 0; Code < MetricsPorts[Count].CodeCount; ++Code)
+         Length = MetricsPrint(Text, Size, Length, "epp2_status_total{port=\"%s\",code=\"%4.4lX\"} %lu\n", MetricsPorts[Count].Port,
+            MetricsPorts[Count].Codes[Code], MetricsPorts[Count].CodeCounts[Code]);
+   Length = MetricsFamily(Text, Size, Length, "epp2_operation_in_progress", "gauge", "1 while an operation runs on the port.");
+   for (Count = 0; Count < MetricsPortCount; ++Count)
+      Length = MetricsPrint(Text, Size, Length, "epp2_operation_in_progress{port=\"%s\"} %d\n", MetricsPorts[Count].Port, MetricsPorts[Count].Operation ? 1 : 0);
+
+  /**********************************************************/
+ /* Results and bytes of each operation used on each port. */
+/**********************************************************/
+   Length = MetricsFamily(Text, Size, Length, "epp2_operations_total", "counter", "Operations ended, W passed is a device programmed.");
+   for (Count = 0; Count < MetricsPortCount; ++Count)
+      for (Index = 0; Index < METRICS_OPERATION_COUNT; ++Index)
+      {
+         Measured = &(MetricsPorts[Count].Operations[Index]);
+         if (!Measured->Seconds.Count)
+            continue;
+         Length = MetricsPrint(Text, Size, Length, "epp2_operations_total{port=\"%s\",operation=\"%c\",result=\"passed\"} %lu\n",
+            MetricsPorts[Count].Port, METRICS_OPERATIONS[Index], Measured->Passed);
+         Length = MetricsPrint(Text, Size, Length, "epp2_operations_total{port=\"%s\",operation=\"%c\",result=\"failed\"} %lu\n",
+            MetricsPorts[Count].Port, METRICS_OPERATIONS[Index], Measured->Failed);
+      }
+   Length = MetricsFamily(Text, Size, Length, "epp2_operation_bytes_total", "counter", "Bytes of the range or file of the operations.");
+   for (Count = 0; Count < MetricsPortCount; ++Count)
+      for (Index = 0; Index < METRICS_OPERATION_COUNT; ++Index)
+         if (MetricsPorts[Count].Operations[Index].Seconds.Count)
+            Length = MetricsPrint(Text, Size, Length, "epp2_operation_bytes_total{port=\"%s\",operation=\"%c\"} %lu\n",
+               MetricsPorts[Count].Port, METRICS_OPERATIONS[Index], MetricsPorts[Count].Operations[Index].Bytes);
+
+  /****************************************************/
+ /* Histograms of each port, and of each operation.  */
+/****************************************************/
+   Length = MetricsFamily(Text, Size, Length, "epp2_handshake_seconds", "histogram", "Time to find the EPP-2 prompt, setting the baud rate if needed.");
+   for (Count = 0; Count < MetricsPortCount; ++Count)
+   {
+      snprintf(Labels, sizeof(Labels), "port=\"%s\"", MetricsPorts[Count].Port);
+      Length = MetricsHistogram(Text, Size, Length, "epp2_handshake_seconds", Labels, &(MetricsPorts[Count].Handshake), METRICS_HANDSHAKE);
+   }
+   Length = MetricsFamily(Text, Size, Length, "epp2_command_latency_seconds", "histogram", "Time from a command sent to its prompt, less the time to send it.");
+   for (Count = 0; Count < MetricsPortCount; ++Count)
+   {
+      snprintf(Labels, sizeof(Labels), "port=\"%s\"", MetricsPorts[Count].Port);
+      Length = MetricsHistogram(Text, Size, Length, "epp2_command_latency_seconds", Labels, &(MetricsPorts[Count].Latency), METRICS_LATENCY);
+   }
+   Length = MetricsFamily(Text, Size, Length, "epp2_operation_seconds", "histogram", "Time taken by each operation.");
+   for (Count = 0; Count < MetricsPortCount; ++Count)
+      for (Index = 0; Index < METRICS_OPERATION_COUNT; ++Index)
+         if (MetricsPorts[Count].Operations[Index].Seconds.Count)
+         {
+            snprintf(Labels, sizeof(Labels), "port=\"%s\",operation=\"%c\"", MetricsPorts[Count].Port, METRICS_OPERATIONS[Index]);
+            Length = MetricsHistogram(Text, Size, Length, "epp2_operation_seconds", Labels, &(MetricsPorts[Count].Operations[Index].Seconds), METRICS_SECONDS);
+         }
+   Length = MetricsFamily(Text, Size, Length, "epp2_throughput_bytes_per_second", "histogram", "Bytes per second of each operation which passed.");
+   for (Count = 0; Count < MetricsPortCount; ++Count)
+      for (Index = 0; Index < METRICS_OPERATION_COUNT; ++Index)
+         if (MetricsPorts[Count].Operations[Index].Throughput.Count)
+         {
+            snprintf(Labels, sizeof(Labels), "port=\"%s\",operation=\"%c\"", MetricsPorts[Count].Port, METRICS_OPERATIONS[Index]);
+            Length = MetricsHistogram(Text, Size, Length, "epp2_throughput_bytes_per_second", Labels, &(MetricsPorts[Count].Operations[Index].Throughput), METRICS_THROUGHPUT);
+         }
+   pthread_mutex_unlock(&MetricsLock);
+
+   return Length;
+}
@@ -0,0 +1,100 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef __METRICS_H
+#define __METRICS_H
+
+
+#ifndef FALSE
+#define FALSE                 0
+#endif
+#ifndef TRUE
+#define TRUE                  1
+#endif
+
+// Most serial ports measured, and most distinct EPP-2 error codes of each.
+#define METRICS_MAX_PORTS     16
+#define METRICS_MAX_CODES     16
+#define METRICS_PORT_SIZE     255
+// Operations measured, each with its own counters and histograms.
+#define METRICS_OPERATIONS    "ERWVCBFIKM"
+#define METRICS_OPERATION_COUNT 10
+#define METRICS_BUCKETS       10
+// Time between writes of the metrics file while it changes, ms.
+#define METRICS_INTERVAL      1000
+#define METRICS_TEXT_SIZE     0x20000
+// Most time a client of the socket may take to accept the reply, ms.
+#define METRICS_SEND_TIME     1000
+// Counters of each port.
+#define METRICS_SENT          0
+#define METRICS_RECEIVED      1
+#define METRICS_RETRIES       2
+#define METRICS_VERIFY_FAILED 3
+#define METRICS_COUNTERS      4
+// Histograms of each port, and of each operation of a port.
+#define METRICS_HANDSHAKE     0
+#define METRICS_LATENCY       1
+#define METRICS_SECONDS       2
+#define METRICS_THROUGHPUT    3
+
+
+typedef struct
+{
+   unsigned long Buckets[METRICS_BUCKETS];
+   unsigned long Count;
+   double Sum;
+} MetricsHistogramType;
+
+
+typedef struct
+{
+   unsigned long Passed;
+   unsigned long Failed;
+   unsigned long Bytes;
+   MetricsHistogramType Seconds;
+   MetricsHistogramType Throughput;
+} MetricsOperationType;
+
+
+typedef struct
+{
+   char Port[METRICS_PORT_SIZE + 1];
+   unsigned long Counters[METRICS_COUNTERS];
+   MetricsHistogramType Handshake;
+   MetricsHistogramType Latency;
+   MetricsOperationType Operations[METRICS_OPERATION_COUNT];
+   // EPP-2 error codes of the G command, and the times each was received.
+   unsigned long Codes[METRICS_MAX_CODES];
+   unsigned long CodeCounts[METRICS_MAX_CODES];
+   short CodeCount;
+   // Operation in progress, 0 when idle.
+   char Operation;
+} MetricsPortType;
+
+
+short MetricsStart(char* FileName, char* SocketName);
+void MetricsStop(void);
+MetricsPortType* MetricsPort(char* Port);
+void MetricsCount(MetricsPortType* Port, short Counter, unsigned long Value);
+void MetricsObserve(MetricsPortType* Port, short Histogram, double Value);
+void MetricsStatus(MetricsPortType* Port, unsigned long Code);
+void MetricsBegin(MetricsPortType* Port, char Operation);
+void MetricsOperation(MetricsPortType* Port, char Operation, short Passed, unsigned long Bytes, double Seconds);
+int MetricsText(char* Text, int Size);
+
+
+#endif
@@ -0,0 +1,268 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* Preflight - Check a Motorola S record file before it is programmed.      */
+/* ------------------------------------------------------------------------ */
+/* The W and V operations send each line of a file starting with S, so a    */
+/* truncated or damaged file would only be found part way through           */
+/* programming a device, or not at all. The whole file is checked before    */
+/* the serial port is opened: every line must be a valid S record of a      */
+/* length the operations can send, with a correct checksum, the data must   */
+/* fit the device after the offset, any record count must match and the     */
+/* file must end with a termination record. Large files are split at line   */
+/* boundaries into chunks checked on threads of their own.                  */
+/****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "Preflight.h"
+#include "Log.h"
+
+
+// Value + 1 of each hex digit character, 0 for any other character.
+static unsigned char HexDigits[256];
+
+
+
+/***************************************************************/
+/* Check one line of a chunk, without the line end. Returns    */
+/* NULL if the line is valid, or the reason it is not.         */
+/***************************************************************/
+static char* PreflightLine(PreflightChunkType* Chunk, unsigned char* Line, int Length)
+{
+   short AddressSize;
+   unsigned char Invalid = 0;
+   unsigned char Sum = 0;
+   unsigned char Value;
+   int Count;
+   int ByteCount;
+   unsigned long Address = 0;
+
+   if (Length && Line[Length - 1] == '\r')
+      --Length;
+   if (!Length)
+      return NULL;
+   if (Length + 2 > PREFLIGHT_LINE_SIZE)
+      return "RECORD TOO LONG TO SEND";
+   if (Line[0] != 'S')
+      return "NOT AN S-RECORD";
+   if (Line[1] == '0' || Line[1] == '1' || Line[1] == '5' || Line[1] == '9')
+      AddressSize = 2;
+   else if (Line[1] == '2' || Line[1] == '6' || Line[1] == '8')
+      AddressSize = 3;
+   else if (Line[1] == '3' || Line[1] == '7')
+      AddressSize = 4;
+   else
+      return "INVALID RECORD TYPE";
+   if (Length < 4 || (Length & 1))
+      return "INVALID RECORD LENGTH";
+
+  /******************************************************************/
+ /* Decode every byte with the table, a bad digit is found after.  */
+/******************************************************************/
+   ByteCount = (Length - 2) / 2;
+   for (Count = 0; Count < ByteCount; ++Count)
+   {
+      Invalid |= !HexDigits[Line[2 + 2 * Count]] | !HexDigits[Line[3 + 2 * Count]];
+      Value = ((HexDigits[Line[2 + 2 * Count]] - 1) << 4) | ((HexDigits[Line[3 + 2 * Count]] - 1) & 0x0F);
+      Sum += Value;
+      if (Count && Count <= AddressSize)
+         Address = (Address << 8) | Value;
+      else if (!Count && Value != ByteCount - 1)
+         Invalid |= 2;
+   }
+   if (Invalid & 1)
+      return "INVALID HEX DIGIT";
+   if ((Invalid & 2) || ByteCount < AddressSize + 2)
+      return "BYTE COUNT DOES NOT MATCH RECORD LENGTH";
+   if (Sum != 0xFF)
+      return "CHECKSUM ERROR";
+
+   if (Line[1] >= '1' && Line[1] <= '3')
+   {
+      ByteCount -= AddressSize + 2;
+      if (Address < Chunk->Offset || Address - Chunk->Offset + ByteCount > Chunk->Size)
+         return "ADDRESS OUT OF RANGE OF DEVICE";
+      ++Chunk->Records;
+      Chunk->Bytes += ByteCount;
+      Chunk->LastData = Chunk->Lines;
+   }
+   else if (Line[1] == '5' || Line[1] == '6')
+   {
+      Chunk->CountLine = Chunk->Lines;
+      Chunk->CountRecords = Chunk->Records;
+      Chunk->Count = Address;
+      Chunk->CountMask = (Line[1] == '5') ? 0xFFFF : 0xFFFFFF;
+   }
+   else if (Line[1] >= '7' && !Chunk->Termination)
+      Chunk->Termination = Chunk->Lines;
+
+   return NULL;
+}
+
+
+
+/*******************************************************/
+/* Thread checking each line of a chunk, to the first  */
+/* line which is not valid.                            */
+/*******************************************************/
+static void* PreflightThread(void* Data)
+{
+   PreflightChunkType* Chunk = Data;
+   char* Line;
+   char* Next;
+
+   for (Line = Chunk->Text; Line < Chunk->End; Line = Next)
+   {
+      if (!(Next = memchr(Line, '\n', Chunk->End - Line)))
+         Next = Chunk->End;
+      ++Chunk->Lines;
+      if ((Chunk->Error = PreflightLine(Chunk, (unsigned char*)Line, Next - Line)))
+      {
+         Chunk->ErrorLine = Chunk->Lines;
+         break;
+      }
+      if (Next < Chunk->End)
+         ++Next;
+   }
+
+   return NULL;
+}
+
+
+
+/********************************************************************/
+/* Check a Motorola S record file to be programmed into a device of */
+/* Size bytes, with Offset subtracted from each address. The first  */
+/* problem found is displayed. Returns FALSE if the file should not */
+/* be programmed.                                                   */
+/********************************************************************/
+short PreflightMotorola(char* FileName, unsigned long Offset, unsigned long Size)
+{
+   FILE* File;
+   short Count;
+   short ChunkCount;
+   char* Text;
+   char* Error = NULL;
+   long Length;
+   unsigned long Line = 0;
+   unsigned long ErrorLine = 0;
+   unsigned long Records = 0;
+   unsigned long Bytes = 0;
+   unsigned long LastData = 0;
+   unsigned long Termination = 0;
+   unsigned long CountLine = 0;
+   unsigned long CountRecords = 0;
+   PreflightChunkType* CountChunk = NULL;
+   PreflightChunkType Chunks[PREFLIGHT_THREADS];
+
+   if (!(File = fopen(FileName, "rb")))
+   {
+      LogPrint(LOG_ERROR, "Failed to open Motorola S-Record file: %s\r\n", FileName);
+      return FALSE;
+   }
+   fseek(File, 0, SEEK_END);
+   Length = ftell(File);
+   rewind(File);
+   if (Length <= 0 || !(Text = malloc(Length)) || fread(Text, 1, Length, File) != Length)
+   {
+      LogPrint(LOG_ERROR, "Failed to read Motorola S-Record file: %s\r\n", FileName);
+      if (Length > 0)
+         free(Text);
+      fclose(File);
+      return FALSE;
+   }
+   fclose(File);
+   memset(HexDigits, 0, sizeof(HexDigits));
+   for (Count = 0; Count < 16; ++Count)
+   {
+      HexDigits[(unsigned char)"0123456789ABCDEF"[Count]] = Count + 1;
+      HexDigits[(unsigned char)"0123456789abcdef"[Count]] = Count + 1;
+   }
+
+  /******************************************************************/
+ /* Split the file into chunks, ending at line ends, one a thread. */
+/******************************************************************/
+   ChunkCount = Length / PREFLIGHT_CHUNK_SIZE + 1;
+   if (ChunkCount > PREFLIGHT_THREADS)
+      ChunkCount = PREFLIGHT_THREADS;
+   if (ChunkCount > sysconf(_SC_NPROCESSORS_ONLN))
+      ChunkCount = sysconf(_SC_NPROCESSORS_ONLN);
+   if (ChunkCount < 1)
+      ChunkCount = 1;
+   memset(Chunks, 0, sizeof(Chunks));
+   for (Count = 0; Count < ChunkCount; ++Count)
+   {
+      Chunks[Count].Text = Count ? Chunks[Count - 1].End : Text;
+      Chunks[Count].End = &(Text[Length * (Count + 1) / ChunkCount]);
+      while (Chunks[Count].End > Chunks[Count].Text && Chunks[Count].End < &(Text[Length]) && Chunks[Count].End[-1] != '\n')
+         ++Chunks[Count].End;
+      Chunks[Count].Offset = Offset;
+      Chunks[Count].Size = Size;
+      // Without a thread the chunk is checked by this thread when joined.
+      Chunks[Count].Started = !pthread_create(&(Chunks[Count].Thread), NULL, PreflightThread, &(Chunks[Count]));
+   }
+
+  /*****************************************************************/
+ /* Combine the results of the chunks, in the order of the file.  */
+/*****************************************************************/
+   for (Count = 0; Count < ChunkCount; ++Count)
+   {
+      if (Chunks[Count].Started)
+         pthread_join(Chunks[Count].Thread, NULL);
+      else
+         PreflightThread(&(Chunks[Count]));
+      if (!Error && Chunks[Count].Error)
+      {
+         Error = Chunks[Count].Error;
+         ErrorLine = Line + Chunks[Count].ErrorLine;
+      }
+      if (Chunks[Count].LastData)
+         LastData = Line + Chunks[Count].LastData;
+      if (!Termination && Chunks[Count].Termination)
+         Termination = Line + Chunks[Count].Termination;
+      if (Chunks[Count].CountLine)
+      {
+         CountChunk = &(Chunks[Count]);
+         CountLine = Line + Chunks[Count].CountLine;
+         CountRecords = Records + Chunks[Count].CountRecords;
+      }
+      Records += Chunks[Count].Records;
+      Bytes += Chunks[Count].Bytes;
+      Line += Chunks[Count].Lines;
+   }
+   free(Text);
+
+   if (Error)
+      LogPrint(LOG_ERROR, "INVALID S-RECORD: %s LINE %lu: %s\r\n", FileName, ErrorLine, Error);
+   else if (!Termination)
+      LogPrint(LOG_ERROR, "NO S7, S8 OR S9 TERMINATION RECORD, FILE MAY BE TRUNCATED: %s\r\n", FileName);
+   else if (LastData > Termination)
+      LogPrint(LOG_ERROR, "DATA RECORD AFTER TERMINATION RECORD: %s LINE %lu\r\n", FileName, LastData);
+   else if (CountChunk && (CountRecords & CountChunk->CountMask) != CountChunk->Count)
+      LogPrint(LOG_ERROR, "RECORD COUNT DOES NOT MATCH: %s LINE %lu\r\n", FileName, CountLine);
+   else
+   {
+      LogPrint(LOG_INFO, "CHECKED %lu RECORDS, %lu BYTES: %s\r\n", Records, Bytes, FileName);
+      return TRUE;
+   }
+
+   return FALSE;
+}
@@ -0,0 +1,67 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef __PREFLIGHT_H
+#define __PREFLIGHT_H
+
+
+#include <pthread.h>
+
+
+#ifndef FALSE
+#define FALSE                 0
+#endif
+#ifndef TRUE
+#define TRUE                  1
+#endif
+
+// Most threads to check a file with, each checking at least one chunk size.
+#define PREFLIGHT_THREADS     8
+#define PREFLIGHT_CHUNK_SIZE  0x10000
+// Longest record line, with its line end, the W and V operations can send.
+#define PREFLIGHT_LINE_SIZE   254
+
+
+typedef struct
+{
+   char* Text;
+   char* End;
+   unsigned long Offset;
+   unsigned long Size;
+   // Lines of the chunk, the first error and the line of it, from 1.
+   unsigned long Lines;
+   unsigned long ErrorLine;
+   char* Error;
+   unsigned long Records;
+   unsigned long Bytes;
+   unsigned long LastData;
+   unsigned long Termination;
+   // Value of the last S5 or S6 record count, the line of it and the
+   // data records before it.
+   unsigned long CountLine;
+   unsigned long Count;
+   unsigned long CountMask;
+   unsigned long CountRecords;
+   pthread_t Thread;
+   short Started;
+} PreflightChunkType;
+
+
+short PreflightMotorola(char* FileName, unsigned long Offset, unsigned long Size);
+
+
+#endif
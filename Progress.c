@@ -0,0 +1,179 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* Progress - Percent complete and estimated time remaining of a transfer.  */
+/* ------------------------------------------------------------------------ */
+/* The total number of data bytes of an operation is known from the parsed  */
+/* image or the address range. As data bytes are transferred the throughput */
+/* is measured over the most recent samples, giving an estimate of the time */
+/* remaining. Progress is logged at the LOG_INFO level, and can also be     */
+/* written as one line per update to a status file descriptor for a GUI.    */
+/****************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "Image.h"
+#include "Progress.h"
+#include "Log.h"
+
+
+
+/***************************************/
+/* Monotonic time in seconds, as real. */
+/***************************************/
+double ProgressTime(void)
+{
+   struct timespec Now;
+
+   clock_gettime(CLOCK_MONOTONIC, &Now);
+
+   return Now.tv_sec + Now.tv_nsec / 1000000000.0;
+}
+
+
+
+/**************************************************************/
+/* Display the progress, and write it to the status file      */
+/* descriptor as: PROGRESS LABEL DONE TOTAL BYTES/S ETA_SECS. */
+/**************************************************************/
+static void ProgressShow(ProgressType* Progress, double Now)
+{
+   short Oldest;
+   unsigned long Rate = 0;
+   long Remaining = -1;
+   char Buffer[PROGRESS_LINE_SIZE + 1];
+
+  /***************************************************************/
+ /* Throughput over the oldest sample still in the ring buffer. */
+/***************************************************************/
+   Oldest = (Progress->SampleCount < PROGRESS_SAMPLES) ? 0 : Progress->SampleIndex;
+   if (Progress->SampleCount && Now > Progress->SampleTime[Oldest])
+      Rate = (Progress->Done - Progress->SampleDone[Oldest]) / (Now - Progress->SampleTime[Oldest]);
+   if (Rate && Progress->Total >= Progress->Done)
+      Remaining = (Progress->Total - Progress->Done) / Rate;
+
+   if (Remaining < 0)
+      LogPrint(LOG_INFO, "\r%s %3lu%% %lu/%lu BYTES %lu B/s ETA --:--:--   \r", Progress->Label,
+         Progress->Total ? Progress->Done * 100 / Progress->Total : 0, Progress->Done, Progress->Total, Rate);
+   else
+      LogPrint(LOG_INFO, "\r%s %3lu%% %lu/%lu BYTES %lu B/s ETA %2.2ld:%2.2ld:%2.2ld   \r", Progress->Label,
+         Progress->Total ? Progress->Done * 100 / Progress->Total : 0, Progress->Done, Progress->Total, Rate,
+         Remaining / 3600, (Remaining / 60) % 60, Remaining % 60);
+
+   if (Progress->StatusFd >= 0)
+   {
+      sprintf(Buffer, "PROGRESS %s %lu %lu %lu %ld\n", Progress->Label, Progress->Done, Progress->Total, Rate, Remaining);
+      write(Progress->StatusFd, Buffer, strlen(Buffer));
+   }
+}
+
+
+
+/****************************************************************/
+/* Start measuring the progress of an operation of Total bytes. */
+/* StatusFd is -1 if progress is only displayed on stderr.      */
+/****************************************************************/
+void ProgressStart(ProgressType* Progress, char* Label, unsigned long Total, int StatusFd)
+{
+   memset(Progress, 0, sizeof(ProgressType));
+   strncpy(Progress->Label, Label, PROGRESS_LABEL_SIZE);
+   Progress->Total = Total;
+   Progress->StatusFd = StatusFd;
+   Progress->StartTime = ProgressTime();
+   Progress->LastTime = Progress->StartTime;
+   Progress->SampleTime[0] = Progress->StartTime;
+   Progress->SampleCount = 1;
+   Progress->SampleIndex = 1;
+}
+
+
+
+/*****************************************************************/
+/* Add transferred data bytes, sampling and displaying the       */
+/* progress no more often than every PROGRESS_INTERVAL seconds.  */
+/*****************************************************************/
+void ProgressUpdate(ProgressType* Progress, unsigned long Bytes)
+{
+   double Now;
+
+   if (!Progress)
+      return;
+   Progress->Done += Bytes;
+   if ((Now = ProgressTime()) - Progress->LastTime < PROGRESS_INTERVAL)
+      return;
+   Progress->LastTime = Now;
+   ProgressShow(Progress, Now);
+
+   Progress->SampleTime[Progress->SampleIndex] = Now;
+   Progress->SampleDone[Progress->SampleIndex] = Progress->Done;
+   Progress->SampleIndex = (Progress->SampleIndex + 1) % PROGRESS_SAMPLES;
+   if (Progress->SampleCount < PROGRESS_SAMPLES)
+      ++Progress->SampleCount;
+}
+
+
+
+/********************************************************************/
+/* Count the data bytes of the S-Records in received text. A record */
+/* split between two reads is held until the rest is received.      */
+/********************************************************************/
+void ProgressRecords(ProgressType* Progress, char* Data)
+{
+   unsigned short Length;
+   unsigned long Address;
+
+   if (!Progress)
+      return;
+   for (; *Data; ++Data)
+   {
+      if (*Data == '\r' || *Data == '\n')
+      {
+         Progress->Line[Progress->LineLength] = '\0';
+         if (ImageRecordInfo(Progress->Line, &Address, &Length))
+            ProgressUpdate(Progress, Length);
+         Progress->LineLength = 0;
+      }
+      else if (Progress->LineLength < PROGRESS_LINE_SIZE)
+         Progress->Line[Progress->LineLength++] = *Data;
+   }
+}
+
+
+
+/************************************************************/
+/* Display the final progress and the average throughput.   */
+/************************************************************/
+void ProgressEnd(ProgressType* Progress)
+{
+   double Elapsed;
+   char Buffer[PROGRESS_LINE_SIZE + 1];
+
+   if (!Progress)
+      return;
+   Elapsed = ProgressTime() - Progress->StartTime;
+   ProgressShow(Progress, ProgressTime());
+   LogPrint(LOG_INFO, "\n%s %lu BYTES IN %.1f s, %lu B/s\r\n", Progress->Label, Progress->Done, Elapsed,
+      Elapsed > 0 ? (unsigned long)(Progress->Done / Elapsed) : 0);
+   if (Progress->StatusFd >= 0)
+   {
+      sprintf(Buffer, "DONE %s %lu %lu %.1f\n", Progress->Label, Progress->Done, Progress->Total, Elapsed);
+      write(Progress->StatusFd, Buffer, strlen(Buffer));
+   }
+}
@@ -0,0 +1,54 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef __PROGRESS_H
+#define __PROGRESS_H
+
+
+// Throughput is measured over the most recent samples.
+#define PROGRESS_SAMPLES      16
+// Seconds between samples and display updates.
+#define PROGRESS_INTERVAL     0.5
+#define PROGRESS_LINE_SIZE    255
+#define PROGRESS_LABEL_SIZE   15
+
+
+typedef struct
+{
+   char Label[PROGRESS_LABEL_SIZE + 1];
+   unsigned long Total;
+   unsigned long Done;
+   double StartTime;
+   double LastTime;
+   double SampleTime[PROGRESS_SAMPLES];
+   unsigned long SampleDone[PROGRESS_SAMPLES];
+   short SampleCount;
+   short SampleIndex;
+   int StatusFd;
+   short LineLength;
+   char Line[PROGRESS_LINE_SIZE + 1];
+} ProgressType;
+
+
+double ProgressTime(void);
+void ProgressStart(ProgressType* Progress, char* Label, unsigned long Total, int StatusFd);
+void ProgressUpdate(ProgressType* Progress, unsigned long Bytes);
+void ProgressRecords(ProgressType* Progress, char* Data);
+void ProgressEnd(ProgressType* Progress);
+
+
+#endif
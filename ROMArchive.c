@@ -0,0 +1,235 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* ROMArchive - Deduplicating archive of device images read back.           */
+/* ------------------------------------------------------------------------ */
+/* Images read from devices are added to an archive file, where the data    */
+/* shared with images already in the archive is only stored once. Any       */
+/* address range of an image is exported to a Motorola S record or binary   */
+/* file, and the images can be added to the index the EPP-2_PROG command    */
+/* line application I operation uses to identify devices. An image added    */
+/* with the name of an earlier image is a later revision, the latest is     */
+/* exported.                                                                */
+/****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Image.h"
+#include "Index.h"
+#include "Archive.h"
+
+
+#define ARG_COUNT             3
+#define ARG_EXE               0
+#define ARG_OPERATION         1
+#define ARG_ARCHIVE           2
+#define ARG_FILE              3
+#define ARG_NAME              4
+#define ARG_IMAGE             3
+#define ARG_OUT_FILE          4
+#define ARG_START_ADR         5
+#define ARG_END_ADR           6
+#define ARG_INDEX_FILE        3
+
+
+
+/*******************************************************************/
+/* Add a Motorola S record, Intel HEX or binary file to the        */
+/* archive, from its lowest to its highest address, with the       */
+/* unpopulated locations stored as erased.                         */
+/*******************************************************************/
+short ArchiveAddFile(ArchiveType* Archive, char* FileName, char* Name)
+{
+   unsigned long NewBytes;
+   ImageType Image;
+
+   if (!ImageCreate(&Image))
+   {
+      printf("Failed to allocate memory for the image\r\n");
+      return FALSE;
+   }
+   if (!ImageLoadFile(&Image, FileName, 0) || !Image.ByteCount)
+   {
+      printf("NO DATA IN FILE: %s\r\n", FileName);
+      ImageFree(&Image);
+      return FALSE;
+   }
+   if (!ArchiveAdd(Archive, Name, &(Image.Data[Image.Start]), Image.Start, Image.End - Image.Start + 1, &NewBytes))
+   {
+      printf("Failed to add image to archive: %s\r\n", FileName);
+      ImageFree(&Image);
+      return FALSE;
+   }
+   printf("ADDED %lu BYTES %6.6lX - %6.6lX, %lu NEW BYTES STORED: %s\r\n", Image.End - Image.Start + 1, Image.Start, Image.End, NewBytes, Name);
+   ImageFree(&Image);
+
+   return TRUE;
+}
+
+
+
+/******************************************************************/
+/* Export an address range of an image to a Motorola S record     */
+/* file, or with Binary set to a binary file of just the range.   */
+/******************************************************************/
+short ArchiveExport(ArchiveType* Archive, ArchiveImageType* Image, char* FileName, unsigned long Start, unsigned long End, short Binary)
+{
+   FILE* File;
+   short Result;
+   unsigned long Address;
+   unsigned char* Data;
+
+   if (Start < Image->Start || End < Start || End - Image->Start >= Image->Size)
+   {
+      printf("RANGE NOT IN IMAGE %6.6lX - %6.6lX: %s\r\n", Image->Start, Image->Start + Image->Size - 1, Image->Name);
+      return FALSE;
+   }
+   if (!(Data = malloc(End - Start + 1)))
+      return FALSE;
+   if (!ArchiveRead(Archive, Image, Start, End, Data))
+   {
+      printf("Failed to read archive: %s\r\n", Image->Name);
+      free(Data);
+      return FALSE;
+   }
+   if (!(File = fopen(FileName, "wb")))
+   {
+      printf("Failed to create file: %s\r\n", FileName);
+      free(Data);
+      return FALSE;
+   }
+
+   if (Binary)
+      Result = (fwrite(Data, 1, End - Start + 1, File) == End - Start + 1);
+   else
+   {
+      for (Address = Start; Address <= End; Address += IMAGE_RECORD_SIZE)
+         ImageMotorolaRecord(File, Address, &(Data[Address - Start]), (End - Address + 1 < IMAGE_RECORD_SIZE) ? End - Address + 1 : IMAGE_RECORD_SIZE);
+      ImageMotorolaEnd(File, 0);
+      Result = TRUE;
+   }
+   if (fclose(File))
+      Result = FALSE;
+   free(Data);
+   if (Result)
+      printf("EXPORTED %lu BYTES %6.6lX - %6.6lX: %s\r\n", End - Start + 1, Start, End, FileName);
+
+   return Result;
+}
+
+
+
+/*****************************************************************/
+/* List the images of the archive and the storage they share.    */
+/*****************************************************************/
+void ArchiveList(ArchiveType* Archive)
+{
+   unsigned long Count;
+   unsigned long long Total = 0;
+
+   for (Count = 0; Count < Archive->ImageCount; ++Count)
+   {
+      printf("%6.6lX - %6.6lX %8lu BYTES %5lu CHUNKS %s\r\n", Archive->Images[Count].Start, Archive->Images[Count].Start + Archive->Images[Count].Size - 1,
+         Archive->Images[Count].Size, Archive->Images[Count].ChunkCount, Archive->Images[Count].Name);
+      Total += Archive->Images[Count].Size;
+   }
+   printf("%lu IMAGES, %llu BYTES, %lu CHUNKS, %lu BYTES STORED", Archive->ImageCount, Total, Archive->ChunkCount, Archive->Stored);
+   if (Archive->Stored)
+      printf(", %.1f:1", (double)Total / Archive->Stored);
+   printf("\r\n");
+}
+
+
+
+/*****************************************************************/
+/* Add every image of the archive to an index of known images.   */
+/*****************************************************************/
+short ArchiveIndex(ArchiveType* Archive, char* IndexFile)
+{
+   short Result = TRUE;
+   unsigned long Count;
+   unsigned char* Data;
+   ArchiveImageType* Image;
+
+   if (!(Data = malloc(IMAGE_MAX_SIZE)))
+      return FALSE;
+   for (Count = 0; Result && Count < Archive->ImageCount; ++Count)
+   {
+      Image = &(Archive->Images[Count]);
+      if (Image->Size > IMAGE_MAX_SIZE || !ArchiveRead(Archive, Image, Image->Start, Image->Start + Image->Size - 1, Data)
+         || !IndexAppend(IndexFile, Image->Name, Data, Image->Size))
+      {
+         printf("Failed to add image to index: %s\r\n", Image->Name);
+         Result = FALSE;
+      }
+   }
+   free(Data);
+   if (Result)
+      printf("ADDED %lu IMAGES TO INDEX: %s\r\n", Archive->ImageCount, IndexFile);
+
+   return Result;
+}
+
+
+
+int main(int argc, char* argv[])
+{
+   unsigned long Start;
+   unsigned long End;
+   ArchiveType Archive;
+   ArchiveImageType* Image;
+
+   if (argc < ARG_COUNT || !strchr("ALMBI", argv[ARG_OPERATION][0]) || argv[ARG_OPERATION][1]
+      || (argv[ARG_OPERATION][0] == 'A' && argc != 4 && argc != 5)
+      || (argv[ARG_OPERATION][0] == 'L' && argc != 3)
+      || (strchr("MB", argv[ARG_OPERATION][0]) && argc != 5 && argc != 7)
+      || (argv[ARG_OPERATION][0] == 'I' && argc != 4))
+   {
+      printf("\n%s [A] [ARCHIVE] [FILE] <NAME>\n", argv[ARG_EXE]);
+      printf("%s [L] [ARCHIVE]\n", argv[ARG_EXE]);
+      printf("%s [M|B] [ARCHIVE] [NAME] [OUT_FILE] <START_ADR> <END_ADR>\n", argv[ARG_EXE]);
+      printf("%s [I] [ARCHIVE] [INDEX_FILE]\n", argv[ARG_EXE]);
+      printf("WHERE:\n");
+      printf("[A] - Add a Motorola S record, Intel HEX or binary file to the archive.\n");
+      printf("[L] - List the images of the archive.\n");
+      printf("[M] - Export an image, or a range of it, to a Motorola S record file.\n");
+      printf("[B] - Export an image, or a range of it, to a binary file.\n");
+      printf("[I] - Add every image to an index file of known images, e.g. EPP-2_PROG.IDX\n");
+      printf("<NAME> - Name of the image, defaults to the file name.\n");
+      printf("\n");
+   }
+   else if (ArchiveOpen(&Archive, argv[ARG_ARCHIVE]))
+   {
+      if (argv[ARG_OPERATION][0] == 'A')
+         ArchiveAddFile(&Archive, argv[ARG_FILE], (argc > ARG_NAME) ? argv[ARG_NAME] : argv[ARG_FILE]);
+      else if (argv[ARG_OPERATION][0] == 'L')
+         ArchiveList(&Archive);
+      else if (argv[ARG_OPERATION][0] == 'I')
+         ArchiveIndex(&Archive, argv[ARG_INDEX_FILE]);
+      else if (!(Image = ArchiveFind(&Archive, argv[ARG_IMAGE])))
+         printf("NO IMAGE IN ARCHIVE: %s\r\n", argv[ARG_IMAGE]);
+      else
+      {
+         Start = (argc > ARG_START_ADR) ? strtoul(argv[ARG_START_ADR], NULL, 16) : Image->Start;
+         End = (argc > ARG_END_ADR) ? strtoul(argv[ARG_END_ADR], NULL, 16) : Image->Start + Image->Size - 1;
+         ArchiveExport(&Archive, Image, argv[ARG_OUT_FILE], Start, End, argv[ARG_OPERATION][0] == 'B');
+      }
+      ArchiveClose(&Archive);
+   }
+}
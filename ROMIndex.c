@@ -0,0 +1,65 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* ROMIndex - Add a known ROM image to the index used to identify devices.  */
+/* ------------------------------------------------------------------------ */
+/* Hash a binary ROM image file in blocks and append it to an index file.   */
+/* The EPP-2_PROG command line application I operation reads a device and   */
+/* looks up the data in the index, reporting the known images it matches.   */
+/* The name of the image defaults to the name of the binary file.           */
+/****************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include "Image.h"
+#include "Index.h"
+
+
+#define ARG_COUNT             3
+#define ARG_EXE               0
+#define ARG_INDEX_FILE        1
+#define ARG_BIN_FILE          2
+#define ARG_NAME              3
+
+
+
+int main(int argc, char* argv[])
+{
+   ImageType Image;
+
+   if (argc < ARG_COUNT || argc > ARG_COUNT + 1)
+   {
+      printf("\n%s [INDEX_FILE] [BIN_FILE] <NAME>\n", argv[ARG_EXE]);
+      printf("WHERE:\n");
+      printf("[INDEX_FILE] - Index file of known images to add to, e.g. EPP-2_PROG.IDX\n");
+      printf("[BIN_FILE]   - Binary ROM image file to add.\n");
+      printf("<NAME>       - Name reported when a device matches the image.\n");
+      printf("\n");
+   }
+   else if (!ImageCreate(&Image))
+      printf("Failed to allocate memory for the image\r\n");
+   else
+   {
+      if (ImageLoadBinary(&Image, argv[ARG_BIN_FILE], 0) && Image.ByteCount
+         && IndexAppend(argv[ARG_INDEX_FILE], (argc > ARG_NAME) ? argv[ARG_NAME] : argv[ARG_BIN_FILE], Image.Data, Image.ByteCount))
+         printf("ADDED %lu BYTES: %s\r\n", Image.ByteCount, (argc > ARG_NAME) ? argv[ARG_NAME] : argv[ARG_BIN_FILE]);
+      else
+         printf("Failed to add image to index: %s\r\n", argv[ARG_BIN_FILE]);
+      ImageFree(&Image);
+   }
+}
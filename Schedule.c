@@ -0,0 +1,427 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* Schedule - A queue of jobs spread over several EPP-2 Programmers.        */
+/* ------------------------------------------------------------------------ */
+/* A job file lists one device to program on each line, with the steps to   */
+/* perform on it, E, W and V in the order given, the device code and, for   */
+/* W and V, the start address and Motorola S record file:                   */
+/* [STEPS] [DEVICE] <START_ADR> <MOTOROLA_FILE>                             */
+/* Jobs of the same device code are queued together on one EPP-2, so the    */
+/* device code is only sent again when it changes, the largest group of     */
+/* jobs going to the EPP-2 with the fewest jobs queued. Each EPP-2 runs on  */
+/* a thread of its own, taking jobs from the head of its own queue. An      */
+/* EPP-2 with an empty queue steals a job from the tail of the longest      */
+/* queue, one of its selected device code if there is one, so no EPP-2 is   */
+/* idle while another has jobs waiting, and the jobs of an EPP-2 which      */
+/* does not respond are run by the others. Before each job the operator is  */
+/* asked to insert the device, the end of stdin ends the jobs.              */
+/****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "Session.h"
+#include "Preflight.h"
+#include "Schedule.h"
+
+
+
+/*****************************************************************/
+/* Read a job file, each file is checked against the device      */
+/* code of the job. Returns FALSE if any job is invalid.         */
+/*****************************************************************/
+short ScheduleRead(ScheduleType* Schedule, char* FileName)
+{
+   FILE* File;
+   short Result = TRUE;
+   short Count;
+   int Fields;
+   unsigned long Line = 0;
+   ScheduleJobType* Job;
+   char Buffer[BUFF_SIZE + 1];
+
+   memset(Schedule, 0, sizeof(ScheduleType));
+   if (!(File = fopen(FileName, "rt")))
+   {
+      LogPrint(LOG_ERROR, "Failed to open job file: %s\r\n", FileName);
+      return FALSE;
+   }
+
+   while (Result && fgets(Buffer, BUFF_SIZE, File))
+   {
+      ++Line;
+      Buffer[strcspn(Buffer, "\r\n")] = '\0';
+      if (Buffer[0] == '\0' || Buffer[0] == '#')
+         continue;
+      if (Schedule->JobCount == SCHEDULE_MAX_JOBS || !(Job = realloc(Schedule->Jobs, (Schedule->JobCount + 1) * sizeof(ScheduleJobType))))
+      {
+         LogPrint(LOG_ERROR, "TOO MANY JOBS: %s LINE %lu\r\n", FileName, Line);
+         Result = FALSE;
+         break;
+      }
+      Schedule->Jobs = Job;
+      Job = &(Schedule->Jobs[Schedule->JobCount++]);
+      memset(Job, 0, sizeof(ScheduleJobType));
+      Job->Line = Line;
+      Job->Unit = -1;
+      Fields = sscanf(Buffer, "%8s %15s %lX %255s", Job->Steps, Job->Device, &(Job->Start), Job->FileName);
+      if (Fields < 2 || strspn(Job->Steps, SCHEDULE_STEPS) != strlen(Job->Steps) || sscanf(Job->Device, "%X", &(Job->DeviceCode)) != 1
+         || !DeviceSize(Job->DeviceCode) || Fields != (strpbrk(Job->Steps, "WV") ? 4 : 2))
+      {
+         LogPrint(LOG_ERROR, "INVALID JOB: %s LINE %lu\r\n", FileName, Line);
+         Result = FALSE;
+         break;
+      }
+      // A file used again at the same address for the same device is only checked once.
+      for (Count = 0; Count < Schedule->JobCount - 1 && (strcmp(Schedule->Jobs[Count].FileName, Job->FileName)
+         || Schedule->Jobs[Count].Start != Job->Start || Schedule->Jobs[Count].DeviceCode != Job->DeviceCode); ++Count);
+      if (Fields == 4 && Count == Schedule->JobCount - 1 && !PreflightMotorola(Job->FileName, Job->Start, DeviceSize(Job->DeviceCode)))
+      {
+         LogPrint(LOG_ERROR, "FILE CHECK FAILED: %s LINE %lu\r\n", FileName, Line);
+         Result = FALSE;
+      }
+   };
+   fclose(File);
+   if (Result && !Schedule->JobCount)
+   {
+      LogPrint(LOG_ERROR, "NO JOBS IN FILE: %s\r\n", FileName);
+      Result = FALSE;
+   }
+   if (!Result)
+      ScheduleFree(Schedule);
+
+   return Result;
+}
+
+
+
+/*****************************************************************/
+/* Set up an EPP-2 for each port of SERIAL_PORTS, or for the one */
+/* SERIAL_PORT, each with the profile of its own serial port.    */
+/*****************************************************************/
+short ScheduleUnits(ScheduleType* Schedule, ConfigType* Config)
+{
+   char* Port;
+   char* Next;
+   char Ports[BUFF_SIZE + 1];
+   ScheduleUnitType* Unit;
+
+   strcpy(Ports, Config->SerialPorts[0] ? (char*)Config->SerialPorts : (char*)Config->SerialPort);
+   for (Port = strtok_r(Ports, ", ", &Next); Port && Schedule->UnitCount < SCHEDULE_MAX_UNITS; Port = strtok_r(NULL, ", ", &Next))
+   {
+      Unit = &(Schedule->Units[Schedule->UnitCount]);
+      memset(Unit, 0, sizeof(ScheduleUnitType));
+      Unit->Schedule = Schedule;
+      Unit->Index = Schedule->UnitCount++;
+      Unit->Config = *Config;
+      strcpy(Unit->Config.SerialPort, Port);
+      // One trace file can not record several EPP-2s.
+      Unit->Config.TraceFile[0] = '\0';
+      ConfigReadProfile(&(Unit->Config));
+      if (!(Unit->Queue = calloc(Schedule->JobCount, sizeof(short))))
+         return FALSE;
+   }
+
+   return Schedule->UnitCount > 0;
+}
+
+
+
+/*****************************************************************/
+/* Queue the jobs of each device code together, the largest      */
+/* group first, on the EPP-2 with the fewest jobs queued.        */
+/*****************************************************************/
+void ScheduleAssign(ScheduleType* Schedule)
+{
+   short Job;
+   short Other;
+   short Count;
+   short Largest;
+   short LargestCount;
+   short Unit;
+   short Least;
+   char* Assigned;
+
+   if (!(Assigned = calloc(Schedule->JobCount, 1)))
+      return;
+   for (;;)
+   {
+      for (Job = 0, Largest = -1, LargestCount = 0; Job < Schedule->JobCount; ++Job)
+      {
+         if (Assigned[Job])
+            continue;
+         for (Other = Job, Count = 0; Other < Schedule->JobCount; ++Other)
+            if (!Assigned[Other] && Schedule->Jobs[Other].DeviceCode == Schedule->Jobs[Job].DeviceCode)
+               ++Count;
+         if (Count > LargestCount)
+         {
+            Largest = Job;
+            LargestCount = Count;
+         }
+      }
+      if (Largest < 0)
+         break;
+
+      for (Unit = 1, Least = 0; Unit < Schedule->UnitCount; ++Unit)
+         if (Schedule->Units[Unit].Tail < Schedule->Units[Least].Tail)
+            Least = Unit;
+      for (Job = Largest; Job < Schedule->JobCount; ++Job)
+         if (!Assigned[Job] && Schedule->Jobs[Job].DeviceCode == Schedule->Jobs[Largest].DeviceCode)
+         {
+            Assigned[Job] = TRUE;
+            Schedule->Units[Least].Queue[Schedule->Units[Least].Tail++] = Job;
+         }
+   };
+   free(Assigned);
+}
+
+
+
+/*****************************************************************/
+/* Take the next job for an EPP-2, from its own queue, or stolen */
+/* from the tail of the longest queue, a job of the device code  */
+/* already selected if there is one. Returns -1 when no jobs are */
+/* left.                                                         */
+/*****************************************************************/
+static short ScheduleTake(ScheduleUnitType* Unit)
+{
+   short Job = -1;
+   short Count;
+   short Position;
+   ScheduleType* Schedule = Unit->Schedule;
+   ScheduleUnitType* Victim = NULL;
+
+   pthread_mutex_lock(&(Schedule->Lock));
+   if (!Schedule->Stopped && Unit->Head < Unit->Tail)
+      Job = Unit->Queue[Unit->Head++];
+   else if (!Schedule->Stopped)
+   {
+      for (Count = 0; Count < Schedule->UnitCount; ++Count)
+         if (Schedule->Units[Count].Tail - Schedule->Units[Count].Head > (Victim ? Victim->Tail - Victim->Head : 0))
+            Victim = &(Schedule->Units[Count]);
+      if (Victim)
+      {
+         for (Position = Victim->Tail - 1; Position > Victim->Head
+            && Schedule->Jobs[Victim->Queue[Position]].DeviceCode != Unit->DeviceCode; --Position);
+         if (Schedule->Jobs[Victim->Queue[Position]].DeviceCode != Unit->DeviceCode)
+            Position = Victim->Tail - 1;
+         Job = Victim->Queue[Position];
+         memmove(&(Victim->Queue[Position]), &(Victim->Queue[Position + 1]), (Victim->Tail - Position - 1) * sizeof(short));
+         --Victim->Tail;
+         ++Unit->Stolen;
+      }
+   }
+   pthread_mutex_unlock(&(Schedule->Lock));
+
+   return Job;
+}
+
+
+
+/*****************************************************************/
+/* Ask the operator to insert the device of a job, one EPP-2 at  */
+/* a time. Returns FALSE at the end of stdin, ending all jobs.   */
+/*****************************************************************/
+static short ScheduleInsert(ScheduleUnitType* Unit, ScheduleJobType* Job)
+{
+   short Result;
+   char Buffer[BUFF_SIZE + 1];
+
+   pthread_mutex_lock(&(Unit->Schedule->Console));
+   LogFlush();
+   printf("\r\nUNIT %d %s: INSERT DEVICE %s FOR JOB LINE %lu %s %s, PRESS ENTER\r\n", Unit->Index, Unit->Config.SerialPort,
+      Job->Device, Job->Line, Job->Steps, Job->FileName);
+   fflush(stdout);
+   Result = (fgets(Buffer, BUFF_SIZE, stdin) != NULL);
+   pthread_mutex_unlock(&(Unit->Schedule->Console));
+
+   if (!Result)
+   {
+      pthread_mutex_lock(&(Unit->Schedule->Lock));
+      Unit->Schedule->Stopped = TRUE;
+      pthread_mutex_unlock(&(Unit->Schedule->Lock));
+   }
+
+   return Result;
+}
+
+
+
+/*****************************************************************/
+/* Perform the steps of a job, the device code is only sent when */
+/* it differs from the last job of the EPP-2. Returns FALSE when */
+/* a step fails.                                                 */
+/*****************************************************************/
+static short ScheduleJob(ScheduleUnitType* Unit, ScheduleJobType* Job)
+{
+   char* Step;
+   short Passed;
+   double Start;
+   unsigned long Status[STATUS_COUNT];
+   SessionType* Session = &(Unit->Session);
+
+   if (Unit->DeviceCode != Job->DeviceCode)
+   {
+      Unit->DeviceCode = 0;
+      if (!SessionSelectDevice(Session, Job->Device))
+         return FALSE;
+      Unit->DeviceCode = Job->DeviceCode;
+      ++Unit->Selects;
+   }
+
+   for (Step = Job->Steps; *Step; ++Step)
+   {
+      LogPrint(LOG_INFO, "\r\nUNIT %d: JOB LINE %lu STEP %c\r\n", Unit->Index, Job->Line, *Step);
+      MetricsBegin(Session->Metrics, *Step);
+      Start = ProgressTime();
+      // The whole device is empty checked, whatever range the last job left set.
+      if (*Step == 'E')
+         Passed = SessionSetRange(Session, 0, DeviceSize(Job->DeviceCode) - 1) && SessionSetOffset(Session, 0) && SessionEmpty(Session);
+      else if ((Passed = SessionSetStart(Session, Job->Start) && SessionSetOffset(Session, Job->Start)))
+      {
+         if (*Step == 'W')
+            SessionWrite(Session, Job->FileName, 0, ADDRESS_MAX, NULL);
+         else
+            SessionVerify(Session, Job->FileName, 0, ADDRESS_MAX, NULL);
+         Passed = SessionStatus(Session, Status) && !Status[STATUS_ERROR];
+      }
+      // Only the bytes of an empty check are known, W and V count their serial bytes.
+      MetricsOperation(Session->Metrics, *Step, Passed, (*Step == 'E') ? DeviceSize(Job->DeviceCode) : 0, ProgressTime() - Start);
+      if (!Passed)
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+
+/*****************************************************************/
+/* Thread of one EPP-2, running jobs until there are none left.  */
+/* An EPP-2 which can not be opened leaves its jobs to others.   */
+/*****************************************************************/
+static void* ScheduleThread(void* Context)
+{
+   short Index;
+   double Start;
+   ScheduleUnitType* Unit = (ScheduleUnitType*)Context;
+   ScheduleJobType* Job;
+
+   if (!SessionOpen(&(Unit->Session), &(Unit->Config)))
+   {
+      LogPrint(LOG_ERROR, "UNIT %d NOT AVAILABLE: %s\r\n", Unit->Index, Unit->Config.SerialPort);
+      return NULL;
+   }
+   if (!SessionHandshakeTries(&(Unit->Session), SCHEDULE_TRIES))
+   {
+      LogPrint(LOG_ERROR, "UNIT %d NOT RESPONDING: %s\r\n", Unit->Index, Unit->Config.SerialPort);
+      SessionClose(&(Unit->Session));
+      return NULL;
+   }
+
+   while ((Index = ScheduleTake(Unit)) >= 0)
+   {
+      Job = &(Unit->Schedule->Jobs[Index]);
+      if (!ScheduleInsert(Unit, Job))
+         break;
+      Start = ProgressTime();
+      Job->Unit = Unit->Index;
+      Job->Result = ScheduleJob(Unit, Job) ? SCHEDULE_PASSED : SCHEDULE_FAILED;
+      Job->Time = ProgressTime() - Start;
+      Unit->Busy += Job->Time;
+      ++Unit->Jobs;
+      if (Job->Result == SCHEDULE_FAILED)
+         ++Unit->Failed;
+      LogPrint(Job->Result == SCHEDULE_PASSED ? LOG_INFO : LOG_ERROR, "\r\nUNIT %d %s: JOB LINE %lu %s IN %.1f s\r\n", Unit->Index,
+         Unit->Config.SerialPort, Job->Line, Job->Result == SCHEDULE_PASSED ? "PASSED" : "FAILED", Job->Time);
+   };
+   SessionClose(&(Unit->Session));
+
+   return NULL;
+}
+
+
+
+/*****************************************************************/
+/* Run the jobs on every EPP-2 at once and display the result of */
+/* each job and EPP-2. Returns TRUE if every job passed.         */
+/*****************************************************************/
+short ScheduleRun(ScheduleType* Schedule)
+{
+   short Count;
+   short Started[SCHEDULE_MAX_UNITS];
+   unsigned long Passed = 0;
+   unsigned long Failed = 0;
+   double Start;
+   ScheduleJobType* Job;
+   ScheduleUnitType* Unit;
+
+   pthread_mutex_init(&(Schedule->Lock), NULL);
+   pthread_mutex_init(&(Schedule->Console), NULL);
+   Start = ProgressTime();
+   for (Count = 0; Count < Schedule->UnitCount; ++Count)
+      Started[Count] = !pthread_create(&(Schedule->Units[Count].Thread), NULL, ScheduleThread, &(Schedule->Units[Count]));
+   for (Count = 0; Count < Schedule->UnitCount; ++Count)
+      if (Started[Count])
+         pthread_join(Schedule->Units[Count].Thread, NULL);
+   pthread_mutex_destroy(&(Schedule->Lock));
+   pthread_mutex_destroy(&(Schedule->Console));
+
+  /**************************************************/
+ /* The result of each job, then of each EPP-2.    */
+/**************************************************/
+   LogFlush();
+   printf("\r\n");
+   for (Count = 0; Count < Schedule->JobCount; ++Count)
+   {
+      Job = &(Schedule->Jobs[Count]);
+      if (Job->Result == SCHEDULE_WAITING)
+         printf("JOB LINE %4lu %-3s %s %s NOT RUN\r\n", Job->Line, Job->Steps, Job->Device, Job->FileName);
+      else
+         printf("JOB LINE %4lu %-3s %s %s UNIT %d %s %.1f s\r\n", Job->Line, Job->Steps, Job->Device, Job->FileName, Job->Unit,
+            Job->Result == SCHEDULE_PASSED ? "PASSED" : "FAILED", Job->Time);
+      Passed += (Job->Result == SCHEDULE_PASSED);
+      Failed += (Job->Result == SCHEDULE_FAILED);
+   }
+   for (Count = 0; Count < Schedule->UnitCount; ++Count)
+   {
+      Unit = &(Schedule->Units[Count]);
+      printf("UNIT %d %s: %lu JOBS, %lu FAILED, %lu STOLEN, %lu DEVICE CODES SENT, BUSY %.1f s\r\n", Unit->Index, Unit->Config.SerialPort,
+         Unit->Jobs, Unit->Failed, Unit->Stolen, Unit->Selects, Unit->Busy);
+   }
+   printf("%d JOBS, %lu PASSED, %lu FAILED, %lu NOT RUN IN %.1f s\r\n", Schedule->JobCount, Passed, Failed,
+      Schedule->JobCount - Passed - Failed, ProgressTime() - Start);
+
+   return Passed == Schedule->JobCount;
+}
+
+
+
+void ScheduleFree(ScheduleType* Schedule)
+{
+   short Count;
+
+   for (Count = 0; Count < Schedule->UnitCount; ++Count)
+      free(Schedule->Units[Count].Queue);
+   free(Schedule->Jobs);
+   Schedule->Jobs = NULL;
+   Schedule->JobCount = 0;
+   Schedule->UnitCount = 0;
+}
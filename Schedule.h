@@ -0,0 +1,107 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef __SCHEDULE_H
+#define __SCHEDULE_H
+
+
+#include <pthread.h>
+#include "Session.h"
+
+
+#ifndef FALSE
+#define FALSE                 0
+#endif
+#ifndef TRUE
+#define TRUE                  1
+#endif
+
+// Most EPP-2s in the SERIAL_PORTS list, and most jobs in a job file.
+#define SCHEDULE_MAX_UNITS    16
+#define SCHEDULE_MAX_JOBS     4096
+// Steps a job can perform on its device, in the order given.
+#define SCHEDULE_STEPS        "EWV"
+#define SCHEDULE_STEP_SIZE    8
+#define SCHEDULE_CODE_SIZE    15
+// Checks for the prompt of an EPP-2 before it is left out.
+#define SCHEDULE_TRIES        3
+// Result of a job.
+#define SCHEDULE_WAITING      0
+#define SCHEDULE_PASSED       1
+#define SCHEDULE_FAILED       2
+
+
+typedef struct
+{
+   char Steps[SCHEDULE_STEP_SIZE + 1];
+   char Device[SCHEDULE_CODE_SIZE + 1];
+   int DeviceCode;
+   unsigned long Start;
+   char FileName[BUFF_SIZE + 1];
+   // Line of the job file, result, the EPP-2 which ran it and the time taken.
+   unsigned long Line;
+   short Result;
+   short Unit;
+   double Time;
+} ScheduleJobType;
+
+
+typedef struct ScheduleStruct ScheduleType;
+
+typedef struct
+{
+   ScheduleType* Schedule;
+   short Index;
+   ConfigType Config;
+   SessionType Session;
+   pthread_t Thread;
+   // Device code selected on the EPP-2, 0 before the first job.
+   int DeviceCode;
+   // Jobs queued for the EPP-2, taken from the head by the EPP-2 and
+   // stolen from the tail by an idle one.
+   short* Queue;
+   short Head;
+   short Tail;
+   unsigned long Jobs;
+   unsigned long Failed;
+   unsigned long Stolen;
+   unsigned long Selects;
+   double Busy;
+} ScheduleUnitType;
+
+
+struct ScheduleStruct
+{
+   short JobCount;
+   ScheduleJobType* Jobs;
+   short UnitCount;
+   ScheduleUnitType Units[SCHEDULE_MAX_UNITS];
+   // Guards the queues of every EPP-2, and the operator console.
+   pthread_mutex_t Lock;
+   pthread_mutex_t Console;
+   short Stopped;
+};
+
+
+short ScheduleRead(ScheduleType* Schedule, char* FileName);
+short ScheduleUnits(ScheduleType* Schedule, ConfigType* Config);
+void ScheduleAssign(ScheduleType* Schedule);
+short ScheduleRun(ScheduleType* Schedule);
+void ScheduleFree(ScheduleType* Schedule);
+
+
+#endif
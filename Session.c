@@ -0,0 +1,1517 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* Session - EPP-2 Programmer session library.                              */
+/* ------------------------------------------------------------------------ */
+/* A session is one open serial port to one EPP-2 Programmer. The library   */
+/* provides the operations of the EPP-2_PROG command line application, for  */
+/* use by other applications. Each operation returns TRUE on success, or    */
+/* FALSE on failure. An operation can also be started on a thread of its    */
+/* own, with a callback on completion, so an application can prepare the    */
+/* next image while a device is programmed, or drive several programmers    */
+/* from one process. All state is held in the session, a session must only  */
+/* be used by one thread at a time.                                         */
+/****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <termios.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+#include "Session.h"
+
+
+static unsigned char* BaudRates[] =
+{
+   "19200", "9600", "4800", "2400", "1200", "600", "300", NULL,
+};
+
+// EPP-2 X command code for each of the baud rates above.
+static unsigned char* BaudCodes[] =
+{
+   "0X\r", "1X\r", "2X\r", "3X\r", "4X\r", "5X\r", "6X\r", NULL,
+};
+
+// Programming pulse of each device code pulse time field, in us.
+static unsigned long PulseTimes[16] =
+{
+   0, 50, 100, 200, 250, 500, 1000, 2500, 5000, 10000, 15000, 20000, 25000, 35000, 45000, 50000,
+};
+
+// Over programming pulses for each device code margin factor field.
+static short MarginFactors[4] =
+{
+   0, 1, 3, 4,
+};
+
+
+
+/*******************************************************/
+/* Display session messages of a level, unless the     */
+/* session is silent, as when embedded in another      */
+/* application.                                        */
+/*******************************************************/
+static void Log(SessionType* Session, short Level, char* Format, ...)
+{
+   va_list Args;
+
+   if (Session->Silent || Level > LogLevel)
+      return;
+   va_start(Args, Format);
+   LogPrintList(Level, Format, Args);
+   va_end(Args);
+}
+
+
+
+/*************************************************************/
+/* Parse the configuration parameters of an open file.       */
+/*************************************************************/
+static void ConfigParse(ConfigType* Config, FILE* File)
+{
+   char Buffer[BUFF_SIZE + 1];
+
+   while (fgets(Buffer, BUFF_SIZE, File))
+   {
+      while (Buffer[0] != '\0' && (Buffer[strlen(Buffer)-1] == '\r' || Buffer[strlen(Buffer)-1] == '\n'))
+      {
+         Buffer[strlen(Buffer)-1] = '\0';
+      };
+      if (!strncmp(Buffer, "SERIAL_PORT=", 12))
+         strcpy(Config->SerialPort, &(Buffer[12]));
+      else if (!strncmp(Buffer, "SERIAL_PORTS=", 13))
+         strcpy(Config->SerialPorts, &(Buffer[13]));
+      else if (!strncmp(Buffer, "BAUD_RATE=", 10))
+         strcpy(Config->BaudRate, &(Buffer[10]));
+      else if (!strncmp(Buffer, "INDEX_FILE=", 11))
+         strcpy(Config->IndexFile, &(Buffer[11]));
+      else if (!strncmp(Buffer, "TRACE_FILE=", 11))
+         strcpy(Config->TraceFile, &(Buffer[11]));
+      else if (!strncmp(Buffer, "STATUS_FD=", 10))
+         Config->StatusFd = atoi(&(Buffer[10]));
+      else if (!strncmp(Buffer, "WRITE_BATCH=", 12))
+         Config->WriteBatch = atoi(&(Buffer[12]));
+      else if (!strncmp(Buffer, "WRITE_RETRIES=", 14))
+         Config->WriteRetries = atoi(&(Buffer[14]));
+      else if (!strncmp(Buffer, "RECORD_SIZE=", 12))
+         Config->RecordSize = atoi(&(Buffer[12]));
+      else if (!strncmp(Buffer, "LOG_LEVEL=", 10) && LogLevelName(&(Buffer[10])) >= 0)
+         Config->LogLevel = LogLevelName(&(Buffer[10]));
+      else if (!strncmp(Buffer, "READ_CHUNK=", 11))
+         Config->ReadChunk = strtoul(&(Buffer[11]), NULL, 0);
+      else if (!strncmp(Buffer, "READ_VERIFY=", 12))
+         Config->ReadVerify = atoi(&(Buffer[12]));
+      else if (!strncmp(Buffer, "LOOP_STEPS=", 11))
+         strcpy(Config->LoopSteps, &(Buffer[11]));
+      else if (!strncmp(Buffer, "LOOP_PROBE=", 11))
+         Config->LoopProbe = strtoul(&(Buffer[11]), NULL, 0);
+      else if (!strncmp(Buffer, "LOOP_SETTLE=", 12))
+         Config->LoopSettle = atoi(&(Buffer[12]));
+      else if (!strncmp(Buffer, "LOW_LATENCY=", 12))
+         Config->LowLatency = atoi(&(Buffer[12]));
+      else if (!strncmp(Buffer, "METRICS_FILE=", 13))
+         strcpy(Config->MetricsFile, &(Buffer[13]));
+      else if (!strncmp(Buffer, "METRICS_SOCKET=", 15))
+         strcpy(Config->MetricsSocket, &(Buffer[15]));
+   };
+}
+
+
+
+/***************************************************************/
+/* Name of a file of the serial port, e.g. the profile file of */
+/* /dev/ttyUSB0 EPP-2_PROG.ttyUSB0.CFG, up to 2 x BUFF_SIZE.   */
+/***************************************************************/
+static void ConfigPortFile(ConfigType* Config, char* Format, char* FileName)
+{
+   char* Port;
+
+   Port = strrchr(Config->SerialPort, '/') ? strrchr(Config->SerialPort, '/') + 1 : (char*)Config->SerialPort;
+   snprintf(FileName, 2 * BUFF_SIZE, Format, Port);
+}
+
+
+
+/*************************************************************/
+/* Read configuration parameters, using the defaults for any */
+/* parameter not in the file. The profile of the serial port */
+/* written by the K operation, if any, is read last. Returns */
+/* FALSE if the file could not be opened.                    */
+/*************************************************************/
+short ConfigRead(ConfigType* Config, char* FileName)
+{
+   FILE* File;
+
+   strcpy(Config->SerialPort, "/dev/ttyUSB0");
+   Config->SerialPorts[0] = '\0';
+   strcpy(Config->BaudRate, "19200");
+   strcpy(Config->IndexFile, "EPP-2_PROG.IDX");
+   Config->TraceFile[0] = '\0';
+   Config->StatusFd = -1;
+   Config->WriteBatch = SESSION_WRITE_BATCH;
+   Config->WriteRetries = SESSION_WRITE_RETRIES;
+   Config->RecordSize = IMAGE_RECORD_SIZE;
+   Config->LogLevel = LOG_TRAFFIC;
+   Config->ReadChunk = SESSION_READ_CHUNK;
+   Config->ReadVerify = TRUE;
+   strcpy(Config->LoopSteps, SESSION_LOOP_STEPS);
+   Config->LoopProbe = SESSION_LOOP_PROBE;
+   Config->LoopSettle = SESSION_LOOP_SETTLE;
+   Config->LowLatency = TRUE;
+   Config->MetricsFile[0] = '\0';
+   Config->MetricsSocket[0] = '\0';
+   if (!(File = fopen(FileName, "rt")))
+      return FALSE;
+   ConfigParse(Config, File);
+   fclose(File);
+   ConfigReadProfile(Config);
+
+   return TRUE;
+}
+
+
+
+/*************************************************************/
+/* Read the profile of the serial port of the configuration, */
+/* written by the K operation, if there is one. Used again   */
+/* when the serial port is changed, as for each EPP-2 of the */
+/* SERIAL_PORTS list.                                        */
+/*************************************************************/
+void ConfigReadProfile(ConfigType* Config)
+{
+   FILE* File;
+   char Buffer[2 * BUFF_SIZE + 1];
+
+   ConfigPortFile(Config, SESSION_PROFILE, Buffer);
+   if ((File = fopen(Buffer, "rt")))
+   {
+      ConfigParse(Config, File);
+      fclose(File);
+   }
+   if (Config->WriteBatch > SESSION_BATCH_SIZE)
+      Config->WriteBatch = SESSION_BATCH_SIZE;
+   if (Config->RecordSize < 1 || Config->RecordSize > IMAGE_MAX_RECORD)
+      Config->RecordSize = IMAGE_RECORD_SIZE;
+   if (Config->ReadChunk < 1 || Config->ReadChunk > IMAGE_MAX_SIZE)
+      Config->ReadChunk = SESSION_READ_CHUNK;
+   if (!Config->LoopSteps[0] || strspn(Config->LoopSteps, SESSION_LOOP_STEPS) != strlen(Config->LoopSteps))
+      strcpy(Config->LoopSteps, SESSION_LOOP_STEPS);
+   if (Config->LoopProbe > IMAGE_MAX_SIZE)
+      Config->LoopProbe = SESSION_LOOP_PROBE;
+}
+
+
+
+/****************************************************************/
+/* Write the baud rate and record size of the configuration to  */
+/* the profile of the serial port. Returns FALSE on failure.    */
+/****************************************************************/
+short ConfigWriteProfile(ConfigType* Config)
+{
+   FILE* File;
+   char Buffer[2 * BUFF_SIZE + 1];
+
+   ConfigPortFile(Config, SESSION_PROFILE, Buffer);
+   if (!(File = fopen(Buffer, "wt")))
+   {
+      LogPrint(LOG_ERROR, "Failed to open profile file for writing: %s\r\n", Buffer);
+      return FALSE;
+   }
+   fprintf(File, "# Written by the EPP-2_PROG K operation for %s\n", Config->SerialPort);
+   fprintf(File, "BAUD_RATE=%s\n", Config->BaudRate);
+   fprintf(File, "RECORD_SIZE=%d\n", Config->RecordSize);
+
+   return fclose(File) ? FALSE : TRUE;
+}
+
+
+
+/**************************************************************/
+/* Size in bytes of the EPROM selected by a device code, from */
+/* the EPROM size field, 2 x 8 Kbit up to 1024 x 8 Kbit.      */
+/**************************************************************/
+unsigned long DeviceSize(int DeviceCode)
+{
+   if ((DeviceCode & 0x0F) < 1 || (DeviceCode & 0x0F) > 10)
+      return 0;
+
+   return 0x400UL << (DeviceCode & 0x0F);
+}
+
+
+
+/****************************************************************/
+/* Time in us to program a byte of the device selected by a     */
+/* device code, one pulse of the pulse time field followed by   */
+/* the over programming pulses of the margin factor field. A    */
+/* byte which needs more than one pulse takes longer.           */
+/****************************************************************/
+unsigned long DeviceByteTime(int DeviceCode)
+{
+   return PulseTimes[(DeviceCode >> 16) & 0x0F] * (1 + MarginFactors[(DeviceCode >> 14) & 0x03]);
+}
+
+
+
+/************************************************/
+/* Monotonic time in ms, for reply deadlines.   */
+/************************************************/
+static double SessionClock(void)
+{
+   struct timespec Now;
+
+   clock_gettime(CLOCK_MONOTONIC, &Now);
+
+   return Now.tv_sec * 1000.0 + Now.tv_nsec / 1000000.0;
+}
+
+
+
+static int LatencyCompare(const void* A, const void* B)
+{
+   return *(unsigned short*)A - *(unsigned short*)B;
+}
+
+
+
+/******************************************************************/
+/* Add a command latency to the history of the session, and set   */
+/* the reply margin from the latency percentile of the history.   */
+/******************************************************************/
+static void LatencyAdd(SessionType* Session, int Latency)
+{
+   unsigned short Sorted[SESSION_LATENCY_COUNT];
+
+   if (Latency >= 0)
+   {
+      Session->Latency[Session->LatencyNext] = (Latency > 0xFFFF) ? 0xFFFF : Latency;
+      Session->LatencyNext = (Session->LatencyNext + 1) % SESSION_LATENCY_COUNT;
+      if (Session->LatencyCount < SESSION_LATENCY_COUNT)
+         ++Session->LatencyCount;
+   }
+   if (Session->LatencyCount < SESSION_LATENCY_SAMPLES)
+   {
+      Session->LatencyMargin = SESSION_LATENCY_DEFAULT;
+      return;
+   }
+   memcpy(Sorted, Session->Latency, Session->LatencyCount * sizeof(unsigned short));
+   qsort(Sorted, Session->LatencyCount, sizeof(unsigned short), LatencyCompare);
+   Session->LatencyMargin = 2 * Sorted[(Session->LatencyCount - 1) * SESSION_LATENCY_PERCENTILE / 100] + SESSION_LATENCY_MIN;
+}
+
+
+
+/******************************************************************/
+/* Read the latency history of the serial port, if there is one.  */
+/******************************************************************/
+static void LatencyRead(SessionType* Session)
+{
+   FILE* File;
+   int Latency;
+   char Buffer[2 * BUFF_SIZE + 1];
+
+   ConfigPortFile(&(Session->Config), SESSION_LATENCY, Buffer);
+   if ((File = fopen(Buffer, "rt")))
+   {
+      while (fgets(Buffer, BUFF_SIZE, File))
+         if (sscanf(Buffer, "%d", &Latency) == 1)
+            LatencyAdd(Session, Latency);
+      fclose(File);
+   }
+   LatencyAdd(Session, -1);
+}
+
+
+
+/******************************************************************/
+/* Write the latency history of the session, oldest first.        */
+/******************************************************************/
+static void LatencyWrite(SessionType* Session)
+{
+   FILE* File;
+   short Count;
+   char Buffer[2 * BUFF_SIZE + 1];
+
+   ConfigPortFile(&(Session->Config), SESSION_LATENCY, Buffer);
+   if (!Session->LatencyCount || !(File = fopen(Buffer, "wt")))
+      return;
+   for (Count = 0; Count < Session->LatencyCount; ++Count)
+      fprintf(File, "%u\n", Session->Latency[(Session->LatencyNext + SESSION_LATENCY_COUNT - Session->LatencyCount + Count) % SESSION_LATENCY_COUNT]);
+   fclose(File);
+}
+
+
+
+/*******************************************************/
+/* Baud rate the serial port of the session is set to. */
+/*******************************************************/
+static int SerialBaud(SessionType* Session)
+{
+   speed_t Speed = cfgetospeed(&(Session->tty));
+
+   if (Speed == B300)
+      return 300;
+   else if (Speed == B600)
+      return 600;
+   else if (Speed == B1200)
+      return 1200;
+   else if (Speed == B2400)
+      return 2400;
+   else if (Speed == B4800)
+      return 4800;
+   else if (Speed == B19200)
+      return 19200;
+
+   return 9600;
+}
+
+
+
+/******************************************************************/
+/* Latency of a command of Characters just answered with a        */
+/* prompt, the time to the prompt less the time to send it.       */
+/******************************************************************/
+static void LatencyCommand(SessionType* Session, int Characters)
+{
+   double Latency;
+
+   if (Session->Prompted < Session->Sent)
+      return;
+   Latency = Session->Prompted - Session->Sent - Characters * 10000.0 / SerialBaud(Session);
+   LatencyAdd(Session, (Latency < 0) ? 0 : Latency);
+   MetricsObserve(Session->Metrics, METRICS_LATENCY, ((Latency < 0) ? 0 : Latency) / 1000);
+}
+
+
+
+/*******************************************************************/
+/* Find the sysfs latency timer file of the USB serial adapter of  */
+/* the serial port, after any link such as /dev/serial/by-id, and  */
+/* the name of its driver, e.g. ftdi_sio. Returns FALSE if the     */
+/* port has no latency timer, as a built in UART or a pty.         */
+/*******************************************************************/
+static short PortTimerFile(SessionType* Session, char* FileName, char* Driver)
+{
+   ssize_t Length;
+   char Path[PATH_MAX];
+   char Link[PATH_MAX];
+   char Name[NAME_MAX + 1];
+
+   if (!realpath(Session->Config.SerialPort, Path))
+      return FALSE;
+   snprintf(Name, NAME_MAX + 1, "%.*s", NAME_MAX, strrchr(Path, '/') ? strrchr(Path, '/') + 1 : Path);
+   snprintf(FileName, 2 * BUFF_SIZE, SESSION_LATENCY_TIMER, Name);
+   snprintf(Link, PATH_MAX, SESSION_PORT_DRIVER, Name);
+   strcpy(Driver, "USB SERIAL");
+   if ((Length = readlink(Link, Path, PATH_MAX - 1)) > 0)
+   {
+      Path[Length] = '\0';
+      snprintf(Driver, BUFF_SIZE, "%.*s", BUFF_SIZE - 1, strrchr(Path, '/') ? strrchr(Path, '/') + 1 : Path);
+   }
+
+   return !access(FileName, F_OK);
+}
+
+
+
+/***************************************************************/
+/* Read or write the latency timer of a USB serial adapter, in */
+/* ms. Writing usually needs root, or a udev rule for the      */
+/* adapter. Returns -1 if the timer could not be read or set.  */
+/***************************************************************/
+static int PortTimer(char* FileName, int Timer)
+{
+   FILE* File;
+   short Read = (Timer < 0);
+
+   if (!(File = fopen(FileName, Read ? "rt" : "wt")))
+      return -1;
+   if (Read && fscanf(File, "%d", &Timer) != 1)
+      Timer = -1;
+   else if (!Read && fprintf(File, "%d\n", Timer) < 0)
+      Timer = -1;
+   if (fclose(File))
+      Timer = -1;
+
+   return Timer;
+}
+
+
+
+/********************************************************************/
+/* Open ports with latency settings to restore, and the handlers of */
+/* SIGINT and SIGTERM they replaced.                                */
+/********************************************************************/
+static SessionType* volatile PortSessions[SESSION_MAX_PORTS];
+static pthread_mutex_t PortLock = PTHREAD_MUTEX_INITIALIZER;
+static short PortCount = 0;
+static void (*PortInterrupt)(int);
+static void (*PortTerminate)(int);
+
+
+
+/******************************************************************/
+/* Put back the latency settings of one port, with only calls     */
+/* which are safe in a signal handler.                            */
+/******************************************************************/
+static void PortReset(SessionType* Session)
+{
+   int File;
+   struct serial_struct Serial;
+
+   if (Session->PortTimer && (File = open(Session->PortTimerName, O_WRONLY)) >= 0)
+   {
+      write(File, Session->PortTimerText, strlen(Session->PortTimerText));
+      close(File);
+   }
+   if (Session->PortLowLatency && !ioctl(Session->SerialPort, TIOCGSERIAL, &Serial))
+   {
+      Serial.flags &= ~ASYNC_LOW_LATENCY;
+      ioctl(Session->SerialPort, TIOCSSERIAL, &Serial);
+   }
+}
+
+
+
+/******************************************************************/
+/* SIGINT or SIGTERM while ports are changed, restore every port  */
+/* then end as the signal would have without the handler.         */
+/******************************************************************/
+static void PortSignal(int Signal)
+{
+   short Count;
+
+   for (Count = 0; Count < SESSION_MAX_PORTS; ++Count)
+      if (PortSessions[Count])
+         PortReset(PortSessions[Count]);
+   signal(Signal, (Signal == SIGINT) ? PortInterrupt : PortTerminate);
+   raise(Signal);
+}
+
+
+
+/******************************************************************/
+/* Add or remove a port with changed latency settings. The signal */
+/* handlers are installed with the first port and removed with    */
+/* the last.                                                      */
+/******************************************************************/
+static void PortWatch(SessionType* Session, short Changed)
+{
+   short Count;
+
+   pthread_mutex_lock(&PortLock);
+   for (Count = 0; Count < SESSION_MAX_PORTS && PortSessions[Count] != (Changed ? NULL : Session); ++Count);
+   if (Count < SESSION_MAX_PORTS)
+   {
+      PortSessions[Count] = Changed ? Session : NULL;
+      // A signal which is ignored stays ignored.
+      if (Changed && !PortCount++)
+      {
+         if ((PortInterrupt = signal(SIGINT, PortSignal)) == SIG_IGN)
+            signal(SIGINT, SIG_IGN);
+         if ((PortTerminate = signal(SIGTERM, PortSignal)) == SIG_IGN)
+            signal(SIGTERM, SIG_IGN);
+      }
+      else if (!Changed && !--PortCount)
+      {
+         signal(SIGINT, PortInterrupt);
+         signal(SIGTERM, PortTerminate);
+      }
+   }
+   pthread_mutex_unlock(&PortLock);
+}
+
+
+
+/********************************************************************/
+/* Lower the latency of the serial port where permitted, which the  */
+/* reply of every command waits on. A USB serial adapter holds back */
+/* a partly filled packet for its latency timer, 16 ms on FTDI, the */
+/* timer is set to SESSION_USB_LATENCY. The driver is asked to pass */
+/* received data on at once with ASYNC_LOW_LATENCY. What is changed */
+/* is displayed, and restored by PortRestore(), or by PortSignal()  */
+/* when the program is ended with SIGINT or SIGTERM.                */
+/********************************************************************/
+static void PortLowLatency(SessionType* Session)
+{
+   int Timer;
+   char FileName[2 * BUFF_SIZE + 1];
+   char Driver[BUFF_SIZE + 1];
+   struct serial_struct Serial;
+
+   if (PortTimerFile(Session, FileName, Driver) && (Timer = PortTimer(FileName, -1)) > SESSION_USB_LATENCY)
+   {
+      if (PortTimer(FileName, SESSION_USB_LATENCY) < 0)
+         Log(Session, LOG_INFO, "LATENCY TIMER %d ms NOT CHANGED, NO PERMISSION: %s\r\n", Timer, FileName);
+      else
+      {
+         Session->PortTimer = Timer;
+         strcpy(Session->PortTimerName, FileName);
+         snprintf(Session->PortTimerText, BUFF_SIZE, "%d\n", Timer);
+         Log(Session, LOG_INFO, "LATENCY TIMER %s: %d ms TO %d ms\r\n", Driver, Timer, SESSION_USB_LATENCY);
+      }
+   }
+   if (!ioctl(Session->SerialPort, TIOCGSERIAL, &Serial) && !(Serial.flags & ASYNC_LOW_LATENCY))
+   {
+      Serial.flags |= ASYNC_LOW_LATENCY;
+      if (ioctl(Session->SerialPort, TIOCSSERIAL, &Serial))
+         Log(Session, LOG_INFO, "LOW LATENCY NOT SET, NO PERMISSION: %s\r\n", Session->Config.SerialPort);
+      else
+      {
+         Session->PortLowLatency = TRUE;
+         Log(Session, LOG_INFO, "LOW LATENCY SET: %s\r\n", Session->Config.SerialPort);
+      }
+   }
+   if (Session->PortTimer || Session->PortLowLatency)
+      PortWatch(Session, TRUE);
+}
+
+
+
+/***************************************************************/
+/* Restore the latency settings changed by PortLowLatency().   */
+/***************************************************************/
+static void PortRestore(SessionType* Session)
+{
+   char FileName[2 * BUFF_SIZE + 1];
+   char Driver[BUFF_SIZE + 1];
+   struct serial_struct Serial;
+
+   if (Session->PortTimer && PortTimerFile(Session, FileName, Driver) && PortTimer(FileName, Session->PortTimer) >= 0)
+      Log(Session, LOG_INFO, "LATENCY TIMER %s: RESTORED %d ms\r\n", Driver, Session->PortTimer);
+   if (Session->PortLowLatency && !ioctl(Session->SerialPort, TIOCGSERIAL, &Serial))
+   {
+      Serial.flags &= ~ASYNC_LOW_LATENCY;
+      ioctl(Session->SerialPort, TIOCSSERIAL, &Serial);
+   }
+   Session->PortTimer = 0;
+   Session->PortLowLatency = FALSE;
+   PortWatch(Session, FALSE);
+}
+
+
+
+/************************************************************/
+/* Open and configure the Linux serial port of the session. */
+/************************************************************/
+short SessionOpen(SessionType* Session, ConfigType* Config)
+{
+   memset(Session, 0, sizeof(SessionType));
+   Session->Config = *Config;
+
+  /**********************************/
+ /* Open Linux serial port device. */
+/**********************************/
+   if ((Session->SerialPort = open(Config->SerialPort, O_RDWR)) < 0)
+   {
+      Log(Session, LOG_ERROR, "Failed to open serial port: %s\n", Config->SerialPort);
+      return FALSE;
+   }
+  /*****************************************/
+ /* Read Linux serial port configuration. */
+/*****************************************/
+   if (tcgetattr(Session->SerialPort, &(Session->tty)))
+   {
+      Log(Session, LOG_ERROR, "Failed to get communication paramaters: %s\n", Config->SerialPort);
+      close(Session->SerialPort);
+      return FALSE;
+   }
+
+  /********************************/
+ /* Configure Linux serial port. */
+/********************************/
+   // Disable parity bit.
+   Session->tty.c_cflag &= ~PARENB;
+   // One stop bit.
+   Session->tty.c_cflag &= ~CSTOPB;
+   // Eight data bits.
+   Session->tty.c_cflag |= CS8;
+   // Enable hardware handshaking.
+   Session->tty.c_cflag |= CRTSCTS;
+   // Disable modem controls.
+   Session->tty.c_cflag |= CREAD | CLOCAL;
+
+   // Enable sending each character, not just at a carrage return.
+   Session->tty.c_lflag &= ~ICANON;
+   // Disable echo.
+   Session->tty.c_lflag &= ~(ECHO | ECHOE | ECHONL);
+   // Disable signal characters.
+   Session->tty.c_lflag &= ~ISIG;
+
+   // Disable software flow control.
+   Session->tty.c_iflag &= ~(IXON | IXOFF | IXANY);
+   // Disable special bytes.
+   Session->tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL);
+   Session->tty.c_oflag &= ~(OPOST | ONLCR);
+
+   // Set timeout.
+   Session->tty.c_cc[VTIME] = 0;
+   Session->tty.c_cc[VMIN] = 0;
+
+   // Set local baud rate.
+   SelectBaudRate(&(Session->tty), Config->BaudRate);
+
+  /******************************************/
+ /* Write Linux serial port configuration. */
+/******************************************/
+   if (tcsetattr(Session->SerialPort, TCSANOW, &(Session->tty)))
+      Log(Session, LOG_ERROR, "Failed to set communication paramaters: %s\n", Config->SerialPort);
+   if (Config->LowLatency)
+      PortLowLatency(Session);
+   Session->Metrics = MetricsPort(Config->SerialPort);
+   LatencyRead(Session);
+   if (Config->TraceFile[0] != '\0')
+      TraceCreate(&(Session->Trace), Config->TraceFile);
+
+   return TRUE;
+}
+
+
+
+void SessionClose(SessionType* Session)
+{
+   if (Session->Busy)
+      SessionWait(Session);
+   PortRestore(Session);
+   close(Session->SerialPort);
+   LatencyWrite(Session);
+   TraceClose(&(Session->Trace));
+}
+
+
+
+/**********************************************/
+/* Check communication, configure remote baud */
+/* rate if remote command prompt not present. */
+/* Keeps trying until the EPP-2 replies.      */
+/**********************************************/
+short SessionHandshake(SessionType* Session)
+{
+   return SessionHandshakeTries(Session, 0);
+}
+
+
+
+/*****************************************************************/
+/* Handshake as SessionHandshake(), giving up after Tries checks */
+/* for the prompt with the baud rate set in between, 0 for no    */
+/* limit. Returns FALSE if the EPP-2 did not reply.              */
+/*****************************************************************/
+short SessionHandshakeTries(SessionType* Session, short Tries)
+{
+   short Count;
+   short TryCount;
+   short Tried = 0;
+   short Result;
+   double Start = SessionClock();
+   char Buffer[BUFF_SIZE + 1];
+
+   do
+   {
+      Log(Session, LOG_INFO, "\r\nCHECK FOR COMMAND PROMT\r\n");
+      Log(Session, LOG_INFO, "=======================\r\n");
+      // Check for remote command prompt.
+      sprintf(Buffer, "%c\r", 0x1B);
+      SendData(Session, FALSE, Buffer);
+      if ((Result = ReceiveData(Session, FALSE, Buffer, SessionTimeout(Session, 2, 0), stderr)) == PROMPT)
+         LatencyCommand(Session, 2);
+      else if (Tries && ++Tried >= Tries)
+      {
+         Log(Session, LOG_ERROR, "NO COMMAND PROMPT AFTER %d TRIES: %s\r\n", Tried, Session->Config.SerialPort);
+         return FALSE;
+      }
+      else
+      {
+  /************************************************************/
+ /* Set local baud rate to EPP-2 default power on baud rate. */
+/************************************************************/
+         Log(Session, LOG_INFO, "\r\nSET EPP-2 BAUD: %s\r\n", Session->Config.BaudRate);
+         Log(Session, LOG_INFO, "=====================\r\n");
+  /***************************/
+ /* Find current baud rate. */
+/***************************/
+         Count = 0;
+         do
+         {
+            // Set local baud rate to default for EPP-2, 9600.
+            SelectBaudRate(&(Session->tty), BaudRates[Count]);
+            if (tcsetattr(Session->SerialPort, TCSANOW, &(Session->tty)))
+               Log(Session, LOG_ERROR, "Failed to set communication paramaters: %s\n", Session->Config.SerialPort);
+  /******************************************************/
+ /* Send cancel current command, ESC [0x1B], to EPP-2. */
+/******************************************************/
+            TryCount = 0;
+            do
+            {
+               // Clear send buffer.
+               sprintf(Buffer, "%c\r", 0x1B);
+               SendData(Session, TRUE, Buffer);
+               // Clear receive buffer.
+               Result = ReceiveData(Session, TRUE, Buffer, SessionTimeout(Session, 2, 0), stderr);
+            } while (Result != PROMPT && ++TryCount < 4);
+            if (Result == PROMPT)
+            {
+               Log(Session, LOG_INFO, "CURRENT BAUD RATE: %s\r\n", BaudRates[Count]);
+               break;
+            }
+         } while (BaudRates[++Count]);
+         // Set remote baud rate to configuration baud rate.
+         for (Count = 0; BaudRates[Count] && strcmp(Session->Config.BaudRate, BaudRates[Count]); ++Count);
+         if (BaudRates[Count])
+            SendData(Session, FALSE, BaudCodes[Count]);
+         else
+         {
+            Log(Session, LOG_ERROR, "INVALID BAUD RATE FOR EPP-2 PROGRAMMER: %s\r\n", Session->Config.BaudRate);
+            return FALSE;
+         }
+         sleep(1);
+  /***************************************************/
+ /* Set local baud rate to configuration baud rate. */
+/***************************************************/
+         // Set local baud rate.
+         SelectBaudRate(&(Session->tty), Session->Config.BaudRate);
+         if (tcsetattr(Session->SerialPort, TCSANOW, &(Session->tty)))
+            Log(Session, LOG_ERROR, "Failed to set communication paramaters: %s\n", Session->Config.SerialPort);
+  /********************************************************/
+ /* Send return to EPP-2 and check for a command prompt. */
+/********************************************************/
+         // With a limit, the next try checks for the prompt instead.
+         if (!Tries)
+            WaitForPrompt(Session);
+      }
+   } while (Result != PROMPT);
+   MetricsObserve(Session->Metrics, METRICS_HANDSHAKE, (SessionClock() - Start) / 1000);
+
+   return TRUE;
+}
+
+
+
+/***************************************************************/
+/* Send a command line to the EPP-2 and wait for the reply.    */
+/* Returns FALSE if the EPP-2 replies with an error.           */
+/***************************************************************/
+short SessionCommand(SessionType* Session, char* Command)
+{
+   short Result;
+   char Buffer[BUFF_SIZE + 1];
+
+   strcpy(Buffer, Command);
+   SendData(Session, FALSE, Buffer);
+   if ((Result = ReceiveData(Session, FALSE, Buffer, SessionTimeout(Session, strlen(Command), 0), stderr)) == PROMPT)
+      LatencyCommand(Session, strlen(Command));
+
+   return Result != TRUE;
+}
+
+
+
+/**************************************************/
+/* Configure the EPP-2 for the device to be used. */
+/**************************************************/
+short SessionSelectDevice(SessionType* Session, char* DeviceCode)
+{
+   char Buffer[BUFF_SIZE + 1];
+
+   sscanf(DeviceCode, "%X", &(Session->DeviceCode));
+   sprintf(Buffer, "%sS\r", DeviceCode);
+
+   return SessionCommand(Session, Buffer);
+}
+
+
+
+/**********************************************/
+/* Set the EPP-2 Start address for a command. */
+/**********************************************/
+short SessionSetStart(SessionType* Session, unsigned long Start)
+{
+   char Buffer[BUFF_SIZE + 1];
+
+   Session->Start = Start;
+   sprintf(Buffer, "%lXP\r", Start);
+
+   return SessionCommand(Session, Buffer);
+}
+
+
+
+/*******************************************************/
+/* Set the EPP-2 Start and Last address for a command. */
+/*******************************************************/
+short SessionSetRange(SessionType* Session, unsigned long Start, unsigned long End)
+{
+   char Buffer[BUFF_SIZE + 1];
+
+   Session->Start = Start;
+   sprintf(Buffer, "%lXP%lXL\r", Start, End);
+
+   return SessionCommand(Session, Buffer);
+}
+
+
+
+/*****************************************************/
+/* Set the EPP-2 Offset, subtracted from the address */
+/* of each record sent to the EPP-2.                 */
+/*****************************************************/
+short SessionSetOffset(SessionType* Session, unsigned long Offset)
+{
+   char Buffer[BUFF_SIZE + 1];
+
+   Session->Offset = Offset;
+   sprintf(Buffer, "%4.4lXO\r", Offset);
+
+   return SessionCommand(Session, Buffer);
+}
+
+
+
+/*********************************************************************/
+/* Send the G command and collect the three EPP-2 result codes, the  */
+/* error code, the sumcheck of the P to L range and the address.     */
+/* Returns FALSE if the three codes were not received.               */
+/*********************************************************************/
+short SessionStatus(SessionType* Session, unsigned long* Status)
+{
+   short Count = 0;
+   int Bytes;
+   int Length = 0;
+   int TimeOut;
+   double Received;
+   char* Token;
+   char Reply[BUFF_SIZE + 1];
+   struct timespec Sleep = { 0, 1000000};
+
+   SendData(Session, FALSE, "G\r");
+   // Allow for the echo, three codes and the prompt.
+   TimeOut = SessionTimeout(Session, 32, 0);
+   Received = SessionClock();
+  /********************************************************/
+ /* Collect the whole reply, up to the EPP-2 prompt '*'. */
+/********************************************************/
+   do
+   {
+      if ((Bytes = read(Session->SerialPort, &(Reply[Length]), BUFF_SIZE - Length)) > 0)
+      {
+         TraceWrite(&(Session->Trace), TRACE_RECEIVED, &(Reply[Length]), Bytes);
+         MetricsCount(Session->Metrics, METRICS_RECEIVED, Bytes);
+         Received = SessionClock();
+         Length += Bytes;
+         if (Reply[Length - 1] == '*')
+         {
+            Session->Prompted = Received;
+            LatencyCommand(Session, 32);
+            break;
+         }
+      }
+      nanosleep(&Sleep, NULL);
+   } while (Length < BUFF_SIZE && SessionClock() - Received < TimeOut);
+   Reply[Length] = '\0';
+   if (!Session->Silent)
+   {
+      LogData(LOG_TRAFFIC, 0, Reply, Length);
+      LogPrint(LOG_TRAFFIC, "\n");
+   }
+
+  /****************************************************************/
+ /* The codes follow the echoed command, one hex value per line. */
+/****************************************************************/
+   Token = strtok(strchr(Reply, '\n') ? strchr(Reply, '\n') : Reply, "\r\n*");
+   while (Token && Count < STATUS_COUNT)
+   {
+      if (strlen(Token) >= 4 && strspn(Token, "0123456789ABCDEFabcdef") == strlen(Token))
+         Status[Count++] = strtoul(Token, NULL, 16);
+      Token = strtok(NULL, "\r\n*");
+   };
+   memcpy(Session->Status, Status, sizeof(Session->Status));
+   if (Count == STATUS_COUNT)
+      MetricsStatus(Session->Metrics, Status[STATUS_ERROR]);
+
+   return Count == STATUS_COUNT;
+}
+
+
+
+/****************************************************************/
+/* Perform an empty check of the device over the address range. */
+/****************************************************************/
+short SessionEmpty(SessionType* Session)
+{
+   unsigned long Status[STATUS_COUNT];
+
+   SendData(Session, FALSE, "T\r");
+   WaitForPrompt(Session);
+
+   return SessionStatus(Session, Status) && !Status[STATUS_ERROR];
+}
+
+
+
+/*****************************************************/
+/* Read data from the device over the address range. */
+/* Returns FALSE if the read ended without a prompt. */
+/*****************************************************/
+short SessionRead(SessionType* Session, FILE* OutStream, ProgressType* Progress)
+{
+   short Result;
+   char Buffer[BUFF_SIZE + 1];
+
+   Session->ReadProgress = Progress;
+   SendData(Session, FALSE, "R\r");
+   // Allow for a line of data between records.
+   if (!(Result = ReceiveData(Session, FALSE, Buffer, SessionTimeout(Session, BUFF_SIZE, 0), OutStream) == PROMPT))
+      Log(Session, LOG_ERROR, "READ TIMED OUT\r\n");
+   Session->ReadProgress = NULL;
+
+   return Result;
+}
+
+
+
+/*****************************************************************/
+/* Read the device from Start to End into an image, at the same  */
+/* addresses. The records are held in a temporary file while     */
+/* they are received, then loaded into the image.                */
+/*****************************************************************/
+short SessionReadImage(SessionType* Session, ImageType* Image, unsigned long Start, unsigned long End, ProgressType* Progress)
+{
+   FILE* File;
+   short Result;
+
+   if (!(File = tmpfile()))
+      return FALSE;
+   if ((Result = SessionSetRange(Session, Start, End) && SessionRead(Session, File, Progress)))
+   {
+      rewind(File);
+      Result = ImageReadMotorola(Image, File, "DEVICE", Session->Offset);
+   }
+   fclose(File);
+
+   return Result;
+}
+
+
+
+/*************************************************************/
+/* Write the Motorola S-Record file records between Start    */
+/* and End to the device.                                    */
+/*************************************************************/
+short SessionWrite(SessionType* Session, char* FileName, unsigned long Start, unsigned long End, ProgressType* Progress)
+{
+   char Buffer[BUFF_SIZE + 1];
+
+   SendData(Session, FALSE, "W\r");
+   ReceiveData(Session, FALSE, Buffer, SessionTimeout(Session, 2, 0), stderr);
+
+   return SendMotorolaFile(Session, "W\r", FileName, Start, End, Progress);
+}
+
+
+
+/*************************************************************/
+/* Verify the Motorola S-Record file records between Start   */
+/* and End to the device data.                               */
+/*************************************************************/
+short SessionVerify(SessionType* Session, char* FileName, unsigned long Start, unsigned long End, ProgressType* Progress)
+{
+   char Buffer[BUFF_SIZE + 1];
+
+   SendData(Session, FALSE, "V\r");
+   ReceiveData(Session, FALSE, Buffer, SessionTimeout(Session, 2, 0), stderr);
+
+   return SendMotorolaFile(Session, "V\r", FileName, Start, End, Progress);
+}
+
+
+
+/**********************************************************/
+/* Thread of an asynchronous operation, performs the job  */
+/* then calls the callback of the job with the result.    */
+/**********************************************************/
+static void* SessionThread(void* Data)
+{
+   SessionType* Session = Data;
+   SessionJobType* Job = &(Session->Job);
+
+   if (Job->Operation == SESSION_EMPTY)
+      Job->Result = SessionEmpty(Session);
+   else if (Job->Operation == SESSION_READ)
+      Job->Result = SessionRead(Session, Job->OutStream, Job->Progress);
+   else if (Job->Operation == SESSION_WRITE)
+      Job->Result = SessionWrite(Session, Job->FileName, Job->Start, Job->End, Job->Progress);
+   else if (Job->Operation == SESSION_VERIFY)
+      Job->Result = SessionVerify(Session, Job->FileName, Job->Start, Job->End, Job->Progress);
+   else
+      Job->Result = FALSE;
+   if (Job->Callback)
+      Job->Callback(Session, Job->Result, Job->Context);
+
+   return NULL;
+}
+
+
+
+/****************************************************************/
+/* Start an operation on a thread of its own. Only one          */
+/* operation can be outstanding on a session, SessionWait()     */
+/* must be called before the session is used again. Returns     */
+/* FALSE if the operation could not be started.                 */
+/****************************************************************/
+short SessionStart(SessionType* Session, SessionJobType* Job)
+{
+   if (Session->Busy)
+      return FALSE;
+   Session->Job = *Job;
+   Session->Job.Result = FALSE;
+   if (pthread_create(&(Session->Thread), NULL, SessionThread, Session))
+      return FALSE;
+   Session->Busy = TRUE;
+
+   return TRUE;
+}
+
+
+
+/*************************************************************/
+/* Wait for the outstanding operation of the session to end, */
+/* returns the result of the operation.                      */
+/*************************************************************/
+short SessionWait(SessionType* Session)
+{
+   if (!Session->Busy)
+      return FALSE;
+   pthread_join(Session->Thread, NULL);
+   Session->Busy = FALSE;
+
+   return Session->Job.Result;
+}
+
+
+
+/********************************************************************/
+/* Time in ms to allow for a reply, after sending Characters which  */
+/* program Bytes of the device: the time to send the characters at  */
+/* the baud rate of the port, the time to program the bytes and the */
+/* reply margin learned from the latency history of the port.       */
+/********************************************************************/
+int SessionTimeout(SessionType* Session, int Characters, unsigned long Bytes)
+{
+   return Characters * 10000L / SerialBaud(Session) + 1 + Bytes * DeviceByteTime(Session->DeviceCode) / 1000 + Session->LatencyMargin;
+}
+
+
+
+/**********************************************************************/
+/* Wait for a command prompt to be available on the EPP-2 Programmer. */
+/**********************************************************************/
+void WaitForPrompt(SessionType* Session)
+{
+   short Result = FALSE;
+   double Start;
+   char Buffer[BUFF_SIZE + 1];
+
+   SendData(Session, TRUE, "\r");
+   Start = SessionClock();
+   do
+   {
+      Result = ReceiveData(Session, TRUE, Buffer, SessionTimeout(Session, 1, 0), stderr);
+   } while (Result != PROMPT && SessionClock() - Start < SESSION_PROMPT_WAIT * 1000.0);
+   // Discard any further prompt, as for a command still in progress.
+   ReceiveData(Session, TRUE, Buffer, SessionTimeout(Session, 1, 0), stderr);
+   if (Result != PROMPT)
+      Log(Session, LOG_ERROR, "WARNING: DIDN'T FIND COMMAND PROMPT\r\n");
+}
+
+
+
+/*************************************************************/
+/* Baud rate supported by the EPP-2, fastest first, NULL     */
+/* after the last.                                           */
+/*************************************************************/
+unsigned char* SessionBaudRate(short Index)
+{
+   if (Index < 0 || Index >= sizeof(BaudRates) / sizeof(BaudRates[0]))
+      return NULL;
+
+   return BaudRates[Index];
+}
+
+
+
+/******************************************************************/
+/* Change the baud rate of the EPP-2, then of the serial port.    */
+/* Returns FALSE if the rate is invalid or the EPP-2 prompt is    */
+/* not found at the new rate, SessionHandshake() recovers from    */
+/* the configuration baud rate.                                   */
+/******************************************************************/
+short SessionSetBaud(SessionType* Session, unsigned char* BaudRate)
+{
+   short Count;
+   char Buffer[BUFF_SIZE + 1];
+
+   for (Count = 0; BaudRates[Count] && strcmp(BaudRate, BaudRates[Count]); ++Count);
+   if (!BaudRates[Count])
+   {
+      Log(Session, LOG_ERROR, "INVALID BAUD RATE FOR EPP-2 PROGRAMMER: %s\r\n", BaudRate);
+      return FALSE;
+   }
+   SendData(Session, FALSE, BaudCodes[Count]);
+   sleep(1);
+   SelectBaudRate(&(Session->tty), BaudRate);
+   if (tcsetattr(Session->SerialPort, TCSANOW, &(Session->tty)))
+      Log(Session, LOG_ERROR, "Failed to set communication paramaters: %s\n", Session->Config.SerialPort);
+   strcpy(Session->Config.BaudRate, BaudRate);
+
+   sprintf(Buffer, "%c\r", 0x1B);
+   SendData(Session, TRUE, Buffer);
+
+   return ReceiveData(Session, TRUE, Buffer, SessionTimeout(Session, 2, 0), stderr) == PROMPT;
+}
+
+
+
+/**************************************************************/
+/* Configure the local serial port on Linux for the specified */
+/* baud rate, provided as a string value.                     */
+/**************************************************************/
+void SelectBaudRate(struct termios* tty, unsigned char* BaudRate)
+{
+  /******************************************************/
+ /* Select a vaid baud rate for the Linux serial port. */
+/******************************************************/
+   if (!strcmp(BaudRate, "300"))
+   {
+      cfsetispeed(tty, B300);
+      cfsetospeed(tty, B300);
+   }
+   else if (!strcmp(BaudRate, "600"))
+   {
+      cfsetispeed(tty, B600);
+      cfsetospeed(tty, B600);
+   }
+   else if (!strcmp(BaudRate, "1200"))
+   {
+      cfsetispeed(tty, B1200);
+      cfsetospeed(tty, B1200);
+   }
+   else if (!strcmp(BaudRate, "2400"))
+   {
+      cfsetispeed(tty, B2400);
+      cfsetospeed(tty, B2400);
+   }
+   else if (!strcmp(BaudRate, "4800"))
+   {
+      cfsetispeed(tty, B4800);
+      cfsetospeed(tty, B4800);
+   }
+   else if (!strcmp(BaudRate, "9600"))
+   {
+      cfsetispeed(tty, B9600);
+      cfsetospeed(tty, B9600);
+   }
+   else if (!strcmp(BaudRate, "19200"))
+   {
+      cfsetispeed(tty, B19200);
+      cfsetospeed(tty, B19200);
+   }
+   else
+   {
+      cfsetispeed(tty, B9600);
+      cfsetospeed(tty, B9600);
+      LogPrint(LOG_ERROR, "INVALID BAUD RATE FOR EPP-2 PROGRAMMER: %s\r\n", BaudRate);
+   }
+}
+
+
+
+/***************************************************************/
+/* Replace each Find character of a string, in one pass.       */
+/***************************************************************/
+unsigned char* ChrReplace(unsigned char* Data, unsigned char Find, unsigned char Replace)
+{
+   unsigned char* Text;
+
+   for (Text = Data; *Text; ++Text)
+      if (*Text == Find)
+         *Text = Replace;
+
+   return Data;
+}
+
+
+
+/***********************************************************/
+/* Send data to the EPP-2 Programmer, via the serial port. */
+/***********************************************************/
+void SendData(SessionType* Session, unsigned char Silent, char* Data)
+{
+   SendBytes(Session, Silent, Data, strlen(Data));
+}
+
+
+
+/****************************************************************/
+/* Send Length bytes to the EPP-2 Programmer in as few writes   */
+/* as the serial port accepts. The data is logged as traffic    */
+/* with ESC shown as '~', without modifying the data.           */
+/****************************************************************/
+void SendBytes(SessionType* Session, unsigned char Silent, char* Data, int Length)
+{
+   int Bytes;
+   int Sent = 0;
+
+   while (Sent < Length && (Bytes = write(Session->SerialPort, &(Data[Sent]), Length - Sent)) > 0)
+   {
+      TraceWrite(&(Session->Trace), TRACE_SENT, &(Data[Sent]), Bytes);
+      MetricsCount(Session->Metrics, METRICS_SENT, Bytes);
+      Sent += Bytes;
+   }
+   Session->Sent = SessionClock();
+   if (!Silent && !Session->Silent)
+      LogData(LOG_TRAFFIC, '>', Data, Length);
+}
+
+
+
+/****************************************************************/
+/* Receive data from the EPP-2 Programmer, via the serial port, */
+/* until a prompt or until no data is received for TimeOut ms.  */
+/****************************************************************/
+short ReceiveData(SessionType* Session, unsigned char Silent, char* Data, int TimeOut, FILE* OutStream)
+{
+   short Result = FALSE;
+   unsigned char FirstLine = TRUE;
+   unsigned int ByteCount = 0;
+   double Received;
+   int Bytes;
+   char Buffer[BUFF_SIZE + 1];
+   struct timespec Sleep = { 0, 1000000};
+
+   Silent |= Session->Silent;
+   Data[0] = '\0';
+   Received = SessionClock();
+   do
+   {
+      if ((Bytes = read(Session->SerialPort, Buffer, BUFF_SIZE)) > 0)
+      {
+         TraceWrite(&(Session->Trace), TRACE_RECEIVED, Buffer, Bytes);
+         MetricsCount(Session->Metrics, METRICS_RECEIVED, Bytes);
+         Received = SessionClock();
+         ByteCount += Bytes;
+         Buffer[Bytes] = '\0';
+         if (Buffer[Bytes - 1] == '*')
+         {
+            Session->Prompted = Received;
+            // Keep the last of the data received with the prompt.
+            Buffer[Bytes - 1] = '\0';
+            if (OutStream != stderr)
+            {
+               if (Session->ReadProgress)
+                  ProgressRecords(Session->ReadProgress, Buffer);
+               fprintf(OutStream, "%s", Buffer);
+            }
+            Result = PROMPT;
+            break;
+         }
+         if (strcmp(Buffer, "Error\n"))
+            Result = TRUE;
+         if (FirstLine && strchr(Buffer, '\r'))
+         {
+            FirstLine = FALSE;
+            strcpy(Data, &(strchr(Buffer, '\r')[1]));
+         }
+         else
+            strcpy(Data, Buffer);
+         if (OutStream != stderr)
+         {
+            if (Session->ReadProgress)
+               ProgressRecords(Session->ReadProgress, Data);
+            else if (!Silent)
+               LogPrint(LOG_INFO, "%u Bytes Received\r", ByteCount);
+            fprintf(OutStream, "%s", Data);
+         }
+         else if (!Silent)
+            LogData(LOG_TRAFFIC, 0, Data, strlen(Data));
+      }
+      if (TimeOut)
+         nanosleep(&Sleep, NULL);
+   } while (SessionClock() - Received < TimeOut);
+   if (!Silent && ByteCount)
+      LogPrint((OutStream == stderr) ? LOG_TRAFFIC : LOG_INFO, "\n");
+
+   return Result;
+}
+
+
+
+/******************************************************************/
+/* After an error reply, cancel the W or V command and read the   */
+/* EPP-2 status. A programming failure ends the transfer. Other   */
+/* errors are communication errors, the Address of the failure is */
+/* returned so the records from there can be sent again, up to    */
+/* the configured WRITE_RETRIES times for the same address.       */
+/******************************************************************/
+static short SendRecover(SessionType* Session, unsigned long* Address, short* TryCount)
+{
+   unsigned long Status[STATUS_COUNT];
+
+   SendData(Session, TRUE, "\x1B");
+   WaitForPrompt(Session);
+   if (!SessionStatus(Session, Status))
+      return FALSE;
+   if (Status[STATUS_ERROR] & SESSION_FATAL_ERRORS)
+   {
+      Log(Session, LOG_ERROR, "PROGRAMMING FAILED AT: %6.6lX ERROR: %4.4lX\r\n", Status[STATUS_ADDRESS], Status[STATUS_ERROR]);
+      return FALSE;
+   }
+
+   *TryCount = (*TryCount && Status[STATUS_ADDRESS] == *Address) ? *TryCount + 1 : 1;
+   *Address = Status[STATUS_ADDRESS];
+   if (*TryCount > Session->Config.WriteRetries)
+   {
+      Log(Session, LOG_ERROR, "FAILED AFTER %d RETRIES AT: %6.6lX\r\n", Session->Config.WriteRetries, *Address);
+      return FALSE;
+   }
+   Log(Session, LOG_INFO, "\r\nRETRY %d AT: %6.6lX ERROR: %4.4lX\r\n", *TryCount, *Address, Status[STATUS_ERROR]);
+   ++Session->RetryCount;
+   MetricsCount(Session->Metrics, METRICS_RETRIES, 1);
+
+   return TRUE;
+}
+
+
+
+/************************************************************************/
+/* Send the records of a Motorola S-Record file to the EPP-2, after a   */
+/* W or V Command. Only data records inside the Start to End address    */
+/* range are sent. Records are gathered into batches of up to the       */
+/* configured WRITE_BATCH bytes, each batch is sent with one write, so  */
+/* a USB serial adapter transfers full packets rather than one packet   */
+/* per record. RTS/CTS handshaking holds the batch while the EPP-2 is   */
+/* programming. After a communication error the Start address is set    */
+/* to the failing record, and the Command and records are sent again.   */
+/* Returns FALSE if the file could not be sent or an error was replied. */
+/************************************************************************/
+short SendMotorolaFile(SessionType* Session, char* Command, char* FileName, unsigned long Start, unsigned long End, ProgressType* Progress)
+{
+   FILE* File;
+   short Result;
+   short Failed = FALSE;
+   short Resume = FALSE;
+   short TryCount = 0;
+   unsigned short Length;
+   int RecordLength;
+   int BatchLength = 0;
+   long Furthest = 0;
+   unsigned long Address;
+   unsigned long FailAddress = 0;
+   unsigned long BatchBytes = 0;
+   unsigned long BatchData = 0;
+   char Buffer[BUFF_SIZE + 1];
+   char Reply[BUFF_SIZE + 1];
+   char Batch[SESSION_BATCH_SIZE + BUFF_SIZE + 1];
+
+   if (!(File = fopen(FileName, "rt")))
+   {
+      Log(Session, LOG_ERROR, "Failed to open Motorola S-Record file: %s\r\n", FileName);
+      return FALSE;
+   }
+
+   while (TRUE)
+   {
+      Buffer[0] = '\0';
+      if (fgets(Buffer, BUFF_SIZE, File))
+      {
+         if (!ImageRecordInfo(Buffer, &Address, &Length))
+            Length = 0;
+         else if (Address < Start || Address + Length - 1 > End)
+            continue;
+         if (Buffer[0] != 'S')
+            continue;
+  /******************************************************/
+ /* After an error, skip the records already accepted. */
+/******************************************************/
+         if (Resume)
+         {
+            if (Length ? Address - Session->Offset + Length <= FailAddress : Buffer[1] == '0')
+               continue;
+            Resume = FALSE;
+            sprintf(Reply, "%lXP%4.4lXO\r", Length ? Address - Session->Offset : FailAddress, Session->Offset);
+            if (!SessionCommand(Session, Reply))
+            {
+               Failed = TRUE;
+               break;
+            }
+            SendData(Session, FALSE, Command);
+            ReceiveData(Session, FALSE, Reply, SessionTimeout(Session, strlen(Command), 0), stderr);
+         }
+         // Records sent again are not counted twice.
+         if (ftell(File) > Furthest)
+         {
+            Furthest = ftell(File);
+            BatchBytes += Length;
+         }
+         BatchData += Length;
+      }
+      RecordLength = strlen(Buffer);
+  /***************************************************/
+ /* Send the batch when full or at the end of file. */
+/***************************************************/
+      if (BatchLength && (!RecordLength || BatchLength + RecordLength > Session->Config.WriteBatch))
+      {
+         SendBytes(Session, FALSE, Batch, BatchLength);
+         ProgressUpdate(Progress, BatchBytes);
+         // Allow the batch to be sent and programmed before replying.
+         // A prompt before the end of the file also ends the command.
+         Result = ReceiveData(Session, FALSE, Reply, SessionTimeout(Session, BatchLength, BatchData), stderr);
+         BatchLength = 0;
+         BatchBytes = 0;
+         BatchData = 0;
+         if (Reply[0] != '\0' || (Result == PROMPT && RecordLength))
+         {
+            if (!SendRecover(Session, &FailAddress, &TryCount))
+            {
+               Failed = TRUE;
+               break;
+            }
+            Resume = TRUE;
+            rewind(File);
+            continue;
+         }
+      }
+      if (!RecordLength)
+         break;
+      memcpy(&(Batch[BatchLength]), Buffer, RecordLength);
+      BatchLength += RecordLength;
+   };
+   fclose(File);
+   WaitForPrompt(Session);
+   // Restore the Start address, for the sumcheck of the whole range.
+   if (TryCount)
+      SessionSetStart(Session, Session->Start);
+
+   return !Failed;
+}
@@ -0,0 +1,213 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef __SESSION_H
+#define __SESSION_H
+
+
+#include <stdio.h>
+#include <pthread.h>
+#include <termios.h>
+#include "Image.h"
+#include "Progress.h"
+#include "Trace.h"
+#include "Log.h"
+#include "Metrics.h"
+
+
+#ifndef FALSE
+#define FALSE                 0
+#endif
+#ifndef TRUE
+#define TRUE                  1
+#endif
+#define PROMPT                2
+#define BUFF_SIZE             255
+
+#define STATUS_COUNT          3
+#define STATUS_ERROR          0
+#define STATUS_CHECKSUM       1
+#define STATUS_ADDRESS        2
+
+#define ADDRESS_MAX           0xFFFFFFFF
+// Device code bit 7 skips programming the erased, FF, bytes of a file.
+#define DEVICE_SKIP_FF        0x80
+
+// Default bytes of S-Records sent with one write, four 64 byte USB packets.
+#define SESSION_WRITE_BATCH   256
+#define SESSION_BATCH_SIZE    4096
+// Default number of times a failing record is sent again.
+#define SESSION_WRITE_RETRIES 3
+// Error code bits of a programming failure, the other bits report a
+// communication error which is worth retrying: cannot program, illegal bit,
+// address range, not empty, system, selection, Vcc, Vpp & short circuit.
+#define SESSION_FATAL_ERRORS  0xF88B
+// Profile of each serial port, written by the K operation.
+#define SESSION_PROFILE       "EPP-2_PROG.%s.CFG"
+// Command latency history of each serial port, in ms, most recent last.
+#define SESSION_LATENCY       "EPP-2_PROG.%s.LAT"
+#define SESSION_LATENCY_COUNT 64
+// Until enough latencies are known, a reply is allowed this many ms.
+#define SESSION_LATENCY_SAMPLES 4
+#define SESSION_LATENCY_DEFAULT 100
+// Reply margin, twice the percentile latency plus the minimum, in ms.
+#define SESSION_LATENCY_PERCENTILE 95
+#define SESSION_LATENCY_MIN   10
+// Latency timer set on a USB serial adapter while the port is open, in ms,
+// FTDI adapters default to 16 ms, and the sysfs file of the timer of a tty.
+#define SESSION_USB_LATENCY   1
+#define SESSION_LATENCY_TIMER "/sys/class/tty/%s/device/latency_timer"
+#define SESSION_PORT_DRIVER   "/sys/class/tty/%s/device/driver"
+// Most open ports with latency settings to restore on SIGINT or SIGTERM.
+#define SESSION_MAX_PORTS     16
+// Longest wait for a command such as T to end with a prompt, seconds.
+#define SESSION_PROMPT_WAIT   200
+// Default bytes of each chunk of the F operation, read with its own range.
+#define SESSION_READ_CHUNK    0x1000
+// Default steps of the L operation on each device, bytes read to detect the
+// next device, and ms the probe must be unchanged.
+#define SESSION_LOOP_STEPS    "EWV"
+#define SESSION_LOOP_PROBE    0x100
+#define SESSION_LOOP_SETTLE   1500
+
+#define SESSION_EMPTY         'E'
+#define SESSION_READ          'R'
+#define SESSION_WRITE         'W'
+#define SESSION_VERIFY        'V'
+
+
+typedef struct
+{
+   unsigned char SerialPort[BUFF_SIZE+1];
+   // Serial ports of all the EPP-2s for the J operation, comma separated.
+   unsigned char SerialPorts[BUFF_SIZE+1];
+   unsigned char BaudRate[BUFF_SIZE+1];
+   unsigned char IndexFile[BUFF_SIZE+1];
+   unsigned char TraceFile[BUFF_SIZE+1];
+   int StatusFd;
+   int WriteBatch;
+   int WriteRetries;
+   int RecordSize;
+   short LogLevel;
+   // Bytes of each chunk of the F operation, and whether each chunk is
+   // checked against the EPP-2 sumcheck of its range.
+   unsigned long ReadChunk;
+   short ReadVerify;
+   // Steps of the L operation, and the probe detecting the next device.
+   unsigned char LoopSteps[BUFF_SIZE+1];
+   unsigned long LoopProbe;
+   int LoopSettle;
+   // Lower the latency of a USB serial adapter while the port is open.
+   short LowLatency;
+   // Prometheus text file and Unix socket of the metrics, if any.
+   unsigned char MetricsFile[BUFF_SIZE+1];
+   unsigned char MetricsSocket[BUFF_SIZE+1];
+} ConfigType;
+
+
+typedef struct SessionStruct SessionType;
+
+typedef void (*SessionCallback)(SessionType* Session, short Result, void* Context);
+
+typedef struct
+{
+   unsigned char Operation;
+   char FileName[BUFF_SIZE+1];
+   FILE* OutStream;
+   unsigned long Start;
+   unsigned long End;
+   ProgressType* Progress;
+   SessionCallback Callback;
+   void* Context;
+   short Result;
+} SessionJobType;
+
+struct SessionStruct
+{
+   int SerialPort;
+   int DeviceCode;
+   unsigned char Silent;
+   unsigned long Start;
+   unsigned long Offset;
+   ConfigType Config;
+   struct termios tty;
+   ProgressType* ReadProgress;
+   unsigned long Status[STATUS_COUNT];
+   // Records sent again after a communication error.
+   unsigned long RetryCount;
+   // Recent command latencies, and the reply margin derived from them.
+   unsigned short Latency[SESSION_LATENCY_COUNT];
+   short LatencyCount;
+   short LatencyNext;
+   int LatencyMargin;
+   // Time the last data was sent, and the last prompt received, in ms.
+   double Sent;
+   double Prompted;
+   // Adapter latency timer replaced while the port is open, 0 if unchanged,
+   // and whether ASYNC_LOW_LATENCY was set, both restored on close. The
+   // timer file and the text to restore, for the signal handler.
+   int PortTimer;
+   short PortLowLatency;
+   char PortTimerName[2 * BUFF_SIZE + 1];
+   char PortTimerText[BUFF_SIZE + 1];
+   // Record of the bytes sent and received, when TRACE_FILE is set.
+   TraceType Trace;
+   // Metrics of the serial port, NULL when not measuring.
+   MetricsPortType* Metrics;
+   SessionJobType Job;
+   pthread_t Thread;
+   short Busy;
+};
+
+
+short ConfigRead(ConfigType* Config, char* FileName);
+void ConfigReadProfile(ConfigType* Config);
+short ConfigWriteProfile(ConfigType* Config);
+unsigned long DeviceSize(int DeviceCode);
+unsigned long DeviceByteTime(int DeviceCode);
+
+short SessionOpen(SessionType* Session, ConfigType* Config);
+void SessionClose(SessionType* Session);
+short SessionHandshake(SessionType* Session);
+short SessionHandshakeTries(SessionType* Session, short Tries);
+unsigned char* SessionBaudRate(short Index);
+short SessionSetBaud(SessionType* Session, unsigned char* BaudRate);
+short SessionCommand(SessionType* Session, char* Command);
+short SessionSelectDevice(SessionType* Session, char* DeviceCode);
+short SessionSetStart(SessionType* Session, unsigned long Start);
+short SessionSetRange(SessionType* Session, unsigned long Start, unsigned long End);
+short SessionSetOffset(SessionType* Session, unsigned long Offset);
+short SessionStatus(SessionType* Session, unsigned long* Status);
+short SessionEmpty(SessionType* Session);
+short SessionRead(SessionType* Session, FILE* OutStream, ProgressType* Progress);
+short SessionReadImage(SessionType* Session, ImageType* Image, unsigned long Start, unsigned long End, ProgressType* Progress);
+short SessionWrite(SessionType* Session, char* FileName, unsigned long Start, unsigned long End, ProgressType* Progress);
+short SessionVerify(SessionType* Session, char* FileName, unsigned long Start, unsigned long End, ProgressType* Progress);
+short SessionStart(SessionType* Session, SessionJobType* Job);
+short SessionWait(SessionType* Session);
+int SessionTimeout(SessionType* Session, int Characters, unsigned long Bytes);
+
+void WaitForPrompt(SessionType* Session);
+void SelectBaudRate(struct termios* tty, unsigned char* BaudRate);
+unsigned char* ChrReplace(unsigned char* Data, unsigned char Find, unsigned char Replace);
+void SendData(SessionType* Session, unsigned char Silent, char* Data);
+void SendBytes(SessionType* Session, unsigned char Silent, char* Data, int Length);
+short ReceiveData(SessionType* Session, unsigned char Silent, char* Data, int TimeOut, FILE* OutStream);
+short SendMotorolaFile(SessionType* Session, char* Command, char* FileName, unsigned long Start, unsigned long End, ProgressType* Progress);
+
+
+#endif
@@ -0,0 +1,206 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* SplitROM - Split a binary ROM image over a set of EPROM devices.         */
+/* ------------------------------------------------------------------------ */
+/* A 16 or 32 bit target reads each word from two or four devices, one      */
+/* byte lane each, and an image larger than a device is split over banks    */
+/* of devices. The binary image is read once, each byte is sent to the      */
+/* device file of its lane and bank, as a binary file or straight to a      */
+/* Motorola S record file. The device size is the EPROM size of the device  */
+/* code the set is to be programmed with, a partly filled device in the     */
+/* last bank is padded with erased locations.                               */
+/*                                                                          */
+/* Device files are named [BIN_FILE].B[BANK].L[LANE], lane 0 is the byte    */
+/* at the lowest address of each word.                                      */
+/****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Image.h"
+#include "Session.h"
+
+
+#define ARG_COUNT             4
+#define ARG_EXE               0
+#define ARG_BIN_FILE          1
+#define ARG_DEVICE            2
+#define ARG_INTERLEAVE        3
+#define ARG_FORMAT            4
+
+#define SPLIT_MAX_FILES       64
+#define SPLIT_READ_SIZE       0x1000
+
+
+typedef struct
+{
+   FILE* File;
+   unsigned long Address;
+   short Length;
+   unsigned char Record[IMAGE_RECORD_SIZE];
+} SplitFileType;
+
+
+
+/***************************************************************/
+/* Write the bytes buffered for the next S record of a device. */
+/***************************************************************/
+void SplitFlush(SplitFileType* Split)
+{
+   if (Split->Length)
+      ImageMotorolaRecord(Split->File, Split->Address - Split->Length, Split->Record, Split->Length);
+   Split->Length = 0;
+}
+
+
+
+/*****************************************************/
+/* Create the device file of a bank and byte lane.   */
+/*****************************************************/
+short SplitOpen(SplitFileType* Split, char* BinFile, int Bank, int Lane, short Record)
+{
+   char FileName[BUFF_SIZE + 1];
+
+   snprintf(FileName, BUFF_SIZE, "%s.B%d.L%d%s", BinFile, Bank, Lane, Record ? ".HEX" : "");
+   if (!(Split->File = fopen(FileName, "wb")))
+   {
+      printf("Failed to create file: %s\r\n", FileName);
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+
+int main(int argc, char* argv[])
+{
+   FILE* File;
+   short Result = TRUE;
+   short Record;
+   int DeviceCode = 0;
+   int Interleave;
+   int Lane;
+   int Bank;
+   int Count;
+   int FileCount = 0;
+   size_t Length;
+   size_t Position;
+   unsigned long Size;
+   unsigned long ImageSize;
+   unsigned long Offset = 0;
+   SplitFileType* Split;
+   SplitFileType Files[SPLIT_MAX_FILES];
+   unsigned char Buffer[SPLIT_READ_SIZE];
+
+   if (argc < ARG_COUNT || argc > ARG_COUNT + 1 || (argc > ARG_FORMAT && strcmp(argv[ARG_FORMAT], "S")))
+   {
+      printf("\n%s [BIN_FILE] [DEVICE] [INTERLEAVE] <S>\n", argv[ARG_EXE]);
+      printf("WHERE:\n");
+      printf("[BIN_FILE]   - Binary ROM image file to split.\n");
+      printf("[DEVICE]     - Device code of the EPROMs of the set, e.g. 210696\n");
+      printf("[INTERLEAVE] - Bytes in each word of the target, one EPROM each, 1, 2 or 4.\n");
+      printf("<S>          - Write Motorola S record files instead of binary files.\n");
+      printf("\n");
+      return 1;
+   }
+
+   sscanf(argv[ARG_DEVICE], "%X", &DeviceCode);
+   Interleave = atoi(argv[ARG_INTERLEAVE]);
+   Record = (argc > ARG_FORMAT);
+   if (!(Size = DeviceSize(DeviceCode)))
+   {
+      printf("INVALID EPROM SIZE FOR DEVICE CODE: %s\r\n", argv[ARG_DEVICE]);
+      return 1;
+   }
+   if (Interleave != 1 && Interleave != 2 && Interleave != 4)
+   {
+      printf("INVALID INTERLEAVE: %s\r\n", argv[ARG_INTERLEAVE]);
+      return 1;
+   }
+   if (!(File = fopen(argv[ARG_BIN_FILE], "rb")))
+   {
+      printf("Failed to open file: %s\r\n", argv[ARG_BIN_FILE]);
+      return 1;
+   }
+   fseek(File, 0, SEEK_END);
+   ImageSize = ftell(File);
+   rewind(File);
+   FileCount = (ImageSize + Size * Interleave - 1) / (Size * Interleave) * Interleave;
+   if (!ImageSize || FileCount > SPLIT_MAX_FILES)
+   {
+      printf("IMAGE OF %lu BYTES DOES NOT FIT %d DEVICES OF %lu BYTES\r\n", ImageSize, SPLIT_MAX_FILES, Size);
+      fclose(File);
+      return 1;
+   }
+   memset(Files, 0, sizeof(Files));
+
+  /****************************************************************/
+ /* Read the image once, sending each byte to its device file.   */
+/****************************************************************/
+   while (Result && (Length = fread(Buffer, 1, SPLIT_READ_SIZE, File)) > 0)
+   {
+      for (Position = 0; Result && Position < Length; ++Position, ++Offset)
+      {
+         Lane = Offset % Interleave;
+         Bank = (Offset / Interleave) / Size;
+         Split = &(Files[Bank * Interleave + Lane]);
+         if (!Split->File && !(Result = SplitOpen(Split, argv[ARG_BIN_FILE], Bank, Lane, Record)))
+            break;
+         ++Split->Address;
+         if (!Record)
+            fputc(Buffer[Position], Split->File);
+         else
+         {
+            Split->Record[Split->Length++] = Buffer[Position];
+            if (Split->Length == IMAGE_RECORD_SIZE)
+               SplitFlush(Split);
+         }
+      }
+   }
+   fclose(File);
+
+  /******************************************************************/
+ /* Pad the devices of the last bank and report each device file.  */
+/******************************************************************/
+   if (Result)
+      printf("%lu BYTES, %d BANKS OF %d x %lu BYTE DEVICES\r\n", ImageSize, FileCount / Interleave, Interleave, Size);
+   for (Count = 0; Count < FileCount; ++Count)
+   {
+      Split = &(Files[Count]);
+      // A short image may leave the last lanes of the last bank empty.
+      if (!Split->File && (!Result || !(Result = SplitOpen(Split, argv[ARG_BIN_FILE], Count / Interleave, Count % Interleave, Record))))
+         continue;
+      if (Result)
+         printf("%s.B%d.L%d%s %7lu BYTES%s\r\n", argv[ARG_BIN_FILE], Count / Interleave, Count % Interleave, Record ? ".HEX" : "", Split->Address,
+            (!Record && Split->Address < Size) ? " PADDED" : "");
+      if (!Record)
+         for (; Split->Address < Size; ++Split->Address)
+            fputc(0xFF, Split->File);
+      else
+      {
+         SplitFlush(Split);
+         ImageMotorolaEnd(Split->File, 0);
+      }
+      if (fclose(Split->File))
+         Result = FALSE;
+   }
+
+   return Result ? 0 : 1;
+}
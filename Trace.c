@@ -0,0 +1,144 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* Trace - Record of the bytes sent to and received from an EPP-2.          */
+/* ------------------------------------------------------------------------ */
+/* A session with TRACE_FILE configured records every write to and read     */
+/* from the serial port, with the time since the previous one, so a session */
+/* can be played back by TraceReplay without a programmer attached. The     */
+/* file is binary, TRACE_MAGIC followed by one record for each write or     */
+/* read, 7 bytes of header then the data:                                   */
+/* [DIRECTION] [DELAY_US 4 bytes] [LENGTH 2 bytes] [DATA]                   */
+/* Numbers are little endian, so a trace can be replayed on any host.       */
+/****************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include "Progress.h"
+#include "Trace.h"
+#include "Log.h"
+
+
+
+/*************************************************************/
+/* Create a trace file, the first record is timed from its   */
+/* creation. Returns FALSE if it could not be created.       */
+/*************************************************************/
+short TraceCreate(TraceType* Trace, char* FileName)
+{
+   memset(Trace, 0, sizeof(TraceType));
+   if (!(Trace->File = fopen(FileName, "wb")))
+   {
+      LogPrint(LOG_ERROR, "Failed to create trace file: %s\r\n", FileName);
+      return FALSE;
+   }
+   fwrite(TRACE_MAGIC, 1, TRACE_MAGIC_SIZE, Trace->File);
+   Trace->LastTime = ProgressTime();
+
+   return TRUE;
+}
+
+
+
+/****************************************************************/
+/* Open a trace file to read. Returns FALSE if it could not be  */
+/* opened or is not a trace file.                               */
+/****************************************************************/
+short TraceOpen(TraceType* Trace, char* FileName)
+{
+   char Magic[TRACE_MAGIC_SIZE];
+
+   memset(Trace, 0, sizeof(TraceType));
+   if (!(Trace->File = fopen(FileName, "rb")))
+   {
+      LogPrint(LOG_ERROR, "Failed to open trace file: %s\r\n", FileName);
+      return FALSE;
+   }
+   if (fread(Magic, 1, TRACE_MAGIC_SIZE, Trace->File) != TRACE_MAGIC_SIZE || memcmp(Magic, TRACE_MAGIC, TRACE_MAGIC_SIZE))
+   {
+      LogPrint(LOG_ERROR, "INVALID TRACE FILE: %s\r\n", FileName);
+      TraceClose(Trace);
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+
+/*****************************************************************/
+/* Add the data of a write or read to the trace, if it is open.  */
+/*****************************************************************/
+void TraceWrite(TraceType* Trace, unsigned char Direction, char* Data, int Length)
+{
+   int Size;
+   double Now;
+   unsigned long Delay;
+   unsigned char Header[7];
+
+   if (!Trace->File || Length <= 0)
+      return;
+   Now = ProgressTime();
+   // A delay of over an hour is recorded as the longest delay.
+   Delay = ((Now - Trace->LastTime) * 1000000.0 > 0xFFFFFFFF) ? 0xFFFFFFFF : (Now - Trace->LastTime) * 1000000.0;
+   Trace->LastTime = Now;
+   do
+   {
+      Size = (Length > TRACE_DATA_SIZE) ? TRACE_DATA_SIZE : Length;
+      Header[0] = Direction;
+      Header[1] = Delay & 0xFF;
+      Header[2] = (Delay >> 8) & 0xFF;
+      Header[3] = (Delay >> 16) & 0xFF;
+      Header[4] = (Delay >> 24) & 0xFF;
+      Header[5] = Size & 0xFF;
+      Header[6] = (Size >> 8) & 0xFF;
+      fwrite(Header, 1, sizeof(Header), Trace->File);
+      fwrite(Data, 1, Size, Trace->File);
+      Data += Size;
+      Length -= Size;
+      Delay = 0;
+   } while (Length > 0);
+}
+
+
+
+/*****************************************************************/
+/* Read the next record of a trace. Returns FALSE at the end of  */
+/* the trace.                                                    */
+/*****************************************************************/
+short TraceRead(TraceType* Trace, TraceRecordType* Record)
+{
+   unsigned char Header[7];
+
+   if (fread(Header, 1, sizeof(Header), Trace->File) != sizeof(Header))
+      return FALSE;
+   Record->Direction = Header[0];
+   Record->Delay = Header[1] | (Header[2] << 8) | (Header[3] << 16) | ((unsigned long)Header[4] << 24);
+   Record->Length = Header[5] | (Header[6] << 8);
+
+   return fread(Record->Data, 1, Record->Length, Trace->File) == Record->Length;
+}
+
+
+
+void TraceClose(TraceType* Trace)
+{
+   if (Trace->File)
+      fclose(Trace->File);
+   Trace->File = NULL;
+}
@@ -0,0 +1,66 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef __TRACE_H
+#define __TRACE_H
+
+
+#include <stdio.h>
+
+
+#ifndef FALSE
+#define FALSE                 0
+#endif
+#ifndef TRUE
+#define TRUE                  1
+#endif
+
+// First bytes of a trace file, followed by the records.
+#define TRACE_MAGIC           "EPP2TRC1"
+#define TRACE_MAGIC_SIZE      8
+// Direction of a record, sent to or received from the EPP-2.
+#define TRACE_SENT            '>'
+#define TRACE_RECEIVED        '<'
+// Bytes of data held by one record, longer data takes several records.
+#define TRACE_DATA_SIZE       0xFFFF
+
+
+typedef struct
+{
+   FILE* File;
+   double LastTime;
+} TraceType;
+
+
+typedef struct
+{
+   unsigned char Direction;
+   // Time since the previous record, in us.
+   unsigned long Delay;
+   unsigned short Length;
+   unsigned char Data[TRACE_DATA_SIZE];
+} TraceRecordType;
+
+
+short TraceCreate(TraceType* Trace, char* FileName);
+short TraceOpen(TraceType* Trace, char* FileName);
+void TraceWrite(TraceType* Trace, unsigned char Direction, char* Data, int Length);
+short TraceRead(TraceType* Trace, TraceRecordType* Record);
+void TraceClose(TraceType* Trace);
+
+
+#endif
@@ -0,0 +1,201 @@
+// EPP-2_PROG - Linux EPP-2 EPROM Programmer Application
+// Copyright (C) 2024 Jason Birch
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/****************************************************************************/
+/* TraceReplay - Play back a recorded EPP-2 session as a fake programmer.   */
+/* ------------------------------------------------------------------------ */
+/* A trace recorded by EPP-2_PROG with TRACE_FILE set is played back on a   */
+/* pseudo terminal, which EPP-2_PROG uses as its serial port in place of a  */
+/* programmer. The bytes the programmer sent are sent after the recorded    */
+/* delay, divided by SPEED, and the bytes EPP-2_PROG sends are checked      */
+/* against the bytes it sent when recorded. A field failure can then be     */
+/* reproduced, or a change to EPP-2_PROG timed, without a programmer. The   */
+/* replay ends with an error where EPP-2_PROG sends something else.         */
+/****************************************************************************/
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <termios.h>
+#include "Progress.h"
+#include "Trace.h"
+
+
+#define ARG_COUNT             2
+#define ARG_EXE               0
+#define ARG_TRACE_FILE        1
+#define ARG_SPEED             2
+#define ARG_LINK              3
+
+// Longest wait in ms for EPP-2_PROG to send the next recorded bytes.
+#define REPLAY_WAIT_TIME      60000
+// Wait in ms for any bytes sent after the end of the trace.
+#define REPLAY_END_TIME       1000
+
+
+static TraceRecordType Record;
+
+
+
+/******************************************************************/
+/* Read Length bytes sent by EPP-2_PROG, waiting up to TimeOut ms */
+/* for each read. Returns the number of bytes read.               */
+/******************************************************************/
+int ReplayRead(int Master, unsigned char* Data, int Length, int TimeOut)
+{
+   int Bytes;
+   int Count = 0;
+   struct pollfd Poll;
+
+   Poll.fd = Master;
+   Poll.events = POLLIN;
+   while (Count < Length && poll(&Poll, 1, TimeOut) > 0)
+   {
+      if ((Bytes = read(Master, &(Data[Count]), Length - Count)) <= 0)
+         break;
+      Count += Bytes;
+   };
+
+   return Count;
+}
+
+
+
+int main(int argc, char* argv[])
+{
+   int Master;
+   int Slave;
+   int Count;
+   int Position;
+   double Speed = 1.0;
+   double StartTime;
+   unsigned long RecordCount = 0;
+   unsigned long SentBytes = 0;
+   unsigned long ReceivedBytes = 0;
+   char* SlaveName;
+   struct termios tty;
+   struct timespec Sleep;
+   TraceType Trace;
+   unsigned char Buffer[TRACE_DATA_SIZE];
+
+   if (argc < ARG_COUNT || argc > ARG_LINK + 1)
+   {
+      printf("\n%s [TRACE_FILE] <SPEED> <LINK>\n", argv[ARG_EXE]);
+      printf("WHERE:\n");
+      printf("[TRACE_FILE] - Trace of an EPP-2_PROG session, recorded with TRACE_FILE set.\n");
+      printf("<SPEED>      - Replay speed, 1 as recorded, 2 twice as fast, 0 without delays.\n");
+      printf("<LINK>       - Symbolic link to create to the fake serial port, e.g. /tmp/ttyEPP-2\n");
+      printf("\n");
+      return 1;
+   }
+   if (argc > ARG_SPEED)
+      Speed = atof(argv[ARG_SPEED]);
+   if (Speed < 0)
+   {
+      printf("INVALID SPEED: %s\r\n", argv[ARG_SPEED]);
+      return 1;
+   }
+   if (!TraceOpen(&Trace, argv[ARG_TRACE_FILE]))
+      return 1;
+
+  /***************************************************************/
+ /* Create the pseudo terminal EPP-2_PROG uses as serial port.  */
+/***************************************************************/
+   if ((Master = posix_openpt(O_RDWR | O_NOCTTY)) < 0 || grantpt(Master) || unlockpt(Master) || !(SlaveName = ptsname(Master)))
+   {
+      printf("Failed to create pseudo terminal\r\n");
+      TraceClose(&Trace);
+      return 1;
+   }
+   // Hold the slave open, so the port stays up between runs of EPP-2_PROG.
+   if ((Slave = open(SlaveName, O_RDWR | O_NOCTTY)) >= 0 && !tcgetattr(Slave, &tty))
+   {
+      cfmakeraw(&tty);
+      tcsetattr(Slave, TCSANOW, &tty);
+   }
+   if (argc > ARG_LINK)
+   {
+      unlink(argv[ARG_LINK]);
+      if (symlink(SlaveName, argv[ARG_LINK]))
+         printf("Failed to create link: %s\r\n", argv[ARG_LINK]);
+   }
+   printf("FAKE EPP-2 ON %s, SET SERIAL_PORT=%s\r\n", SlaveName, (argc > ARG_LINK) ? argv[ARG_LINK] : SlaveName);
+   fflush(stdout);
+
+  /****************************************************************/
+ /* Check each write of EPP-2_PROG, send each read after delay.  */
+/****************************************************************/
+   StartTime = 0;
+   while (TraceRead(&Trace, &Record))
+   {
+      ++RecordCount;
+      if (Record.Direction == TRACE_SENT)
+      {
+         Count = ReplayRead(Master, Buffer, Record.Length, REPLAY_WAIT_TIME);
+         if (!StartTime)
+            StartTime = ProgressTime();
+         for (Position = 0; Position < Count && Buffer[Position] == Record.Data[Position]; ++Position);
+         if (Position < Record.Length)
+         {
+            printf("DIVERGED AT RECORD %lu, BYTE %lu: EXPECTED %2.2X, ", RecordCount, SentBytes + Position, Record.Data[Position]);
+            if (Position < Count)
+               printf("RECEIVED %2.2X\r\n", Buffer[Position]);
+            else
+               printf("RECEIVED NOTHING\r\n");
+            break;
+         }
+         SentBytes += Count;
+      }
+      else if (Record.Direction == TRACE_RECEIVED)
+      {
+         if (Speed > 0)
+         {
+            Sleep.tv_sec = Record.Delay / Speed / 1000000;
+            Sleep.tv_nsec = (Record.Delay / Speed - Sleep.tv_sec * 1000000.0) * 1000;
+            nanosleep(&Sleep, NULL);
+         }
+         if (write(Master, Record.Data, Record.Length) != Record.Length)
+         {
+            printf("Failed to write to pseudo terminal\r\n");
+            break;
+         }
+         ReceivedBytes += Record.Length;
+      }
+   }
+
+  /*********************************************************/
+ /* At the end of the trace, report anything sent after.  */
+/*********************************************************/
+   Count = feof(Trace.File) ? ReplayRead(Master, Buffer, TRACE_DATA_SIZE, REPLAY_END_TIME) : -1;
+   TraceClose(&Trace);
+   if (Count > 0)
+      printf("%d BYTES SENT AFTER THE END OF THE TRACE\r\n", Count);
+   printf("REPLAYED %lu RECORDS, %lu BYTES FROM EPP-2_PROG, %lu BYTES TO EPP-2_PROG IN %.1f s\r\n",
+      RecordCount, SentBytes, ReceivedBytes, StartTime ? ProgressTime() - StartTime : 0.0);
+   if (argc > ARG_LINK)
+      unlink(argv[ARG_LINK]);
+   if (Slave >= 0)
+      close(Slave);
+   close(Master);
+
+   return Count ? 1 : 0;
+}